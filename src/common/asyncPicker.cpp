@@ -0,0 +1,118 @@
+#include "asyncPicker.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+AsyncPicker::AsyncPicker() :
+  _pbo(0),
+  _fence(nullptr),
+  _previousTarget(-1),
+  _previousVP(1.f),
+  _hasResult(false) {
+  glGenBuffers(1, &_pbo);
+}
+
+AsyncPicker::~AsyncPicker() {
+  if (_fence)
+    glDeleteSync(_fence);
+
+  glDeleteBuffers(1, &_pbo);
+}
+
+void AsyncPicker::init(const Texture* depthTexture, glm::ivec2 fboSize, glm::ivec4 screenRect) {
+  _fboSize = fboSize;
+
+  _depthInColorBufferShader.load("src/shaders/2D_shaders/2D.vert", "src/shaders/2D_shaders/depthToColor.frag");
+  _depthInColorBufferFBO.init(fboSize.x, fboSize.y, GL_RGBA, GL_RGBA, GL_UNSIGNED_BYTE);
+  _depthTexturedRectangle.reset(new TexturedRectangle(depthTexture, screenRect));
+
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, _pbo);
+  glBufferData(GL_PIXEL_PACK_BUFFER, 4 * sizeof(GLubyte), nullptr, GL_STREAM_READ);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+void AsyncPicker::update(glm::ivec2 fboTarget, const glm::mat4& renderedVP) {
+  resolvePendingRead();
+
+  // A single read in flight, the next one waits for it
+  if (_fence)
+    return;
+
+  if (fboTarget.x < 0 || fboTarget.y < 0 || fboTarget.x >= _fboSize.x || fboTarget.y >= _fboSize.y)
+    return;
+
+  // Only read once the cursor and the camera rest, a moving target would be out of date anyway
+  bool resting = fboTarget == _previousTarget && renderedVP == _previousVP;
+  _previousTarget = fboTarget;
+  _previousVP = renderedVP;
+
+  if (!resting)
+    return;
+
+  // Already read
+  if (_hasResult && fboTarget == _resultTarget && renderedVP == _resultVP)
+    return;
+
+  _depthInColorBufferFBO.bind();
+
+  // Only the pixel read is converted
+  glEnable(GL_SCISSOR_TEST);
+  glScissor(fboTarget.x, fboTarget.y, 1, 1);
+  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+  _depthInColorBufferShader.bind();
+  _depthTexturedRectangle->draw();
+  Shader::unbind();
+
+  glDisable(GL_SCISSOR_TEST);
+
+  // With a pack buffer bound, glReadPixels only schedules the copy
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, _pbo);
+  glReadPixels(fboTarget.x, fboTarget.y, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, BUFFER_OFFSET(0));
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+  FrameBufferObject::unbind();
+
+  _fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  _pendingTarget = fboTarget;
+  _pendingVP = renderedVP;
+}
+
+void AsyncPicker::resolvePendingRead() {
+  if (!_fence)
+    return;
+
+  GLint status = GL_UNSIGNALED;
+  glGetSynciv(_fence, GL_SYNC_STATUS, 1, nullptr, &status);
+
+  if (status != GL_SIGNALED)
+    return;
+
+  glDeleteSync(_fence);
+  _fence = nullptr;
+
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, _pbo);
+  const GLubyte* depthBytes = (const GLubyte*) glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, 4 * sizeof(GLubyte), GL_MAP_READ_BIT);
+
+  if (depthBytes) {
+    const glm::vec4 bit_shift = glm::vec4(1.0/(256.0*256.0*256.0), 1.0/(256.0*256.0), 1.0/256.0, 1.0);
+    float depth = glm::dot(glm::vec4(depthBytes[0], depthBytes[1], depthBytes[2], depthBytes[3]) / 255.f, bit_shift);
+
+    _result = glm::unProject(glm::vec3(_pendingTarget.x, _pendingTarget.y, depth),
+      glm::mat4(1.f), _pendingVP, glm::vec4(0, 0, _fboSize.x, _fboSize.y));
+    _resultTarget = _pendingTarget;
+    _resultVP = _pendingVP;
+    _hasResult = true;
+
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+  }
+
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+bool AsyncPicker::getPickedPos(glm::ivec2 fboTarget, const glm::mat4& viewProjection, glm::vec3& pickedPos) const {
+  if (!_hasResult || fboTarget != _resultTarget || viewProjection != _resultVP)
+    return false;
+
+  pickedPos = _result;
+  return true;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "opengl.h"
+#include <glm/glm.hpp>
+
+#include <memory>
+#include <stddef.h> // size_t
+
+#include "frameBufferObject.h"
+#include "shader.h"
+#include "texturedRectangle.h"
+
+/** Reads the depth of the rendered frame under the cursor without stalling the CPU.
+  * Once the cursor and the camera rest for a frame, the depth of that pixel is packed
+  * into a color buffer, copied into a pixel buffer object and a fence is inserted. The buffer is only mapped once the fence is signaled, a
+  * frame or more later. The picked position can then be used as long as the
+  * camera and the cursor have not moved.
+  */
+class AsyncPicker {
+public:
+  AsyncPicker();
+  ~AsyncPicker();
+  AsyncPicker   (AsyncPicker const&) = delete;
+  void operator=(AsyncPicker const&) = delete;
+
+  // The depth texture has the size fboSize and is displayed on screenRect
+  void init(const Texture* depthTexture, glm::ivec2 fboSize, glm::ivec4 screenRect);
+
+  // Called once per frame, before rendering, while the FBO still contains the previous frame
+  // renderedVP is the view projection matrix that frame was rendered with. Does nothing
+  // while the target moves or once its position is read
+  void update(glm::ivec2 fboTarget, const glm::mat4& renderedVP);
+
+  // Returns false if no position has been read for this pixel and this camera
+  bool getPickedPos(glm::ivec2 fboTarget, const glm::mat4& viewProjection, glm::vec3& pickedPos) const;
+
+private:
+  void resolvePendingRead();
+
+  Shader _depthInColorBufferShader;
+  FrameBufferObject _depthInColorBufferFBO;
+  std::unique_ptr<TexturedRectangle> _depthTexturedRectangle;
+  glm::ivec2 _fboSize;
+
+  GLuint _pbo;
+  GLsync _fence; // nullptr if no read is pending
+  glm::ivec2 _pendingTarget;
+  glm::mat4 _pendingVP;
+
+  // Target of the previous update, a read is only issued when the target rests
+  glm::ivec2 _previousTarget;
+  glm::mat4 _previousVP;
+
+  bool _hasResult;
+  glm::ivec2 _resultTarget;
+  glm::mat4 _resultVP;
+  glm::vec3 _result;
+};
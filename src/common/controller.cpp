@@ -10,6 +10,7 @@
 
 Controller::Controller(SDL2pp::Window& window) :
   _running(true),
+  _startupClock(ClockType::INDEPENDENT),
   _loadingScreen(window),
   _engine(),
   _game(_engine),
@@ -31,6 +32,7 @@ Controller::Controller(SDL2pp::Window& window) :
 }
 
 void Controller::init() {
+  _startupClock.restart();
   _engine.init(_loadingScreen);
   _game.init(_loadingScreen);
 }
@@ -39,10 +41,14 @@ void Controller::init() {
 void Controller::run() {
   Clock frameClock;
   bool previousViewWasLocked = false;
+  bool firstFrame = true;
 
   while (_running) {
     _msElapsed = frameClock.restart();
 
+    // The ticks started by the previous frame ran during its rendering, the events modify their elements
+    _engine.waitForSimulation();
+
     SDL_Event event;
     while (SDL_PollEvent(&event)) {
       if (_game.isViewLocked())
@@ -71,5 +77,10 @@ void Controller::run() {
     _game.update(_msElapsed);
     _game.render();
     SDL_GL_SwapWindow(_window.Get());
+
+    if (firstFrame) {
+      SDL_Log("Time to first frame: %d ms", _startupClock.getElapsedTime());
+      firstFrame = false;
+    }
   }
 }
@@ -31,6 +31,7 @@ private:
 
 	bool _running;
 	int _msElapsed;
+	Clock _startupClock; // Measures the time to the first frame
 
 	LoadingScreen _loadingScreen;
 
@@ -1,5 +1,7 @@
 #include "engine.h"
 
+#include "allocationCounter.h"
+
 #include "opengl.h"
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -9,21 +11,53 @@
 #include "log.h"
 #include "reliefGenerator.h"
 
+#include <SDL.h>
+
+#include <algorithm>
 #include <ctime>
 
+// Chunks around the camera that must be ready before the first frame in fast start
+#define ENGINE_FIRST_FRAME_RADIUS (1.5f * CHUNK_SIZE)
+// Chunks whose herds are generated in a frame while streaming
+#define ENGINE_HERDS_CHUNKS_PER_FRAME 2
+// The ray used for picking advances by this fraction of its height above the terrain, at least the minimum step
+#define ENGINE_PICKING_STEP_FACTOR 0.5f
+#define ENGINE_PICKING_MIN_STEP 5.f
+// Bisections between the last point above the terrain and the first one below
+#define ENGINE_PICKING_REFINEMENTS 10
+
 Engine::Engine() :
   _wireframe(false),
+  _singlePassSprites(false),
+  _frontToBack(true),
+  _overdrawView(false),
+  _fastStart(ENGINE_FAST_START),
+  _startupClock(ClockType::INDEPENDENT),
+  _herds(_terrainGeometry),
   _contentGenerator(_terrainGeometry),
   _ocean(2),
   _mapInfoExtractor(_terrainGeometry),
   _reliefGenerator(_mapInfoExtractor),
-  _terrain(NB_CHUNKS*NB_CHUNKS) {}
+  _chunkSubdivider(_contentGenerator),
+  _terrain(NB_CHUNKS*NB_CHUNKS),
+  _renderedViewProjection(1.f),
+  _nbGPUPicks(0),
+  _nbRayMarchPicks(0),
+  _msSimulationTick(ENGINE_MS_SIMULATION_TICK),
+  _msSimulationLag(0),
+  _nbTicksLastFrame(0),
+  _nbTicksPending(0),
+  _activeChunks(NB_CHUNKS*NB_CHUNKS),
+  _visibleChunks(NB_CHUNKS*NB_CHUNKS),
+  _nbTickAllocations(0) {}
 
 Engine::~Engine() {
+  _simulationThread.join();
   _chunkSubdivider.join();
 }
 
 void Engine::init(LoadingScreen& loadingScreen) {
+  _startupClock.restart();
   srand(time(NULL));
 
   loadingScreen.updateAndRender("Loading shaders", 0);
@@ -31,11 +65,13 @@ void Engine::init(LoadingScreen& loadingScreen) {
   _terrainShader.load("src/shaders/heightmap.vert", "src/shaders/heightmap.frag");
   _igEShader.load("src/shaders/igElement.vert", "src/shaders/igElement.frag");
   _skyboxShader.load("src/shaders/skybox.vert", "src/shaders/skybox.frag");
-  _depthInColorBufferShader.load("src/shaders/2D_shaders/2D.vert", "src/shaders/2D_shaders/depthToColor.frag");
 
   _igEShader.bind();
   glUniform1f(_igEShader.getUniformLocation("elementNearPlane"), ELEMENT_NEAR_PLANE);
+  glUniform2f(_igEShader.getUniformLocation("keptRange"), 0.f, 2.f);
   Shader::unbind();
+  // Value of the height offset of the elements drawn without the attribute array
+  glVertexAttrib1f(4, 0.f);
 
   loadingScreen.updateAndRender("Loading terrain data", 1);
 
@@ -71,26 +107,33 @@ void Engine::init(LoadingScreen& loadingScreen) {
   std::vector<Chunk*> newChunks;
   for (int i = 0; i < NB_CHUNKS; i++) {
     for (int j = 0; j < NB_CHUNKS; j++) {
-      newChunks.push_back(new Chunk(i, j, _terrainTexManager, _terrainGeometry, _chunkSubdivider));
+      newChunks.push_back(new Chunk(i, j, _terrainTexManager, _terrainGeometry, _chunkSubdivider,
+                                    _chunkLodCache, _chunkUploadScheduler));
     }
   }
 
-  for (int i = 0; i < NB_CHUNKS; i++) {
-    for (int j = 0; j < NB_CHUNKS; j++) {
-      _chunkSubdivider.addTask(newChunks[i*NB_CHUNKS + j], 1);
-      _terrain[i*NB_CHUNKS + j] = std::unique_ptr<Chunk>(newChunks[i*NB_CHUNKS + j]);
-    }
+  Camera& cam = Camera::getInstance();
+
+  // The closest chunks are generated first
+  std::vector<size_t> chunksByDistance = getChunksByDistance(cam.getPointedPos());
+
+  for (size_t i = 0; i < chunksByDistance.size(); i++) {
+    _chunkSubdivider.addTask(newChunks[chunksByDistance[i]], 1);
+  }
+
+  for (size_t i = 0; i < newChunks.size(); i++) {
+    _terrain[i] = std::unique_ptr<Chunk>(newChunks[i]);
   }
 
+  _chunkQuadtree.build(NB_CHUNKS);
+
   loadingScreen.updateAndRender("Loading ocean and skybox", 34);
 
   _ocean.setTexture(_terrainTexManager.getTexture((size_t) Biome::OCEAN));
   _skybox.load("res/skybox/");
 
-  Camera& cam = Camera::getInstance();
   _globalFBO.init(cam.getW(), cam.getH(), GL_RGBA, GL_RGBA, GL_UNSIGNED_BYTE);
-  _depthInColorBufferFBO.init(cam.getW(), cam.getH(), GL_RGBA, GL_RGBA, GL_UNSIGNED_BYTE);
-  _depthTexturedRectangle.reset(new TexturedRectangle(_globalFBO.getDepthTexture(), cam.getScreenRect()));
+  _picker.init(_globalFBO.getDepthTexture(), glm::ivec2(cam.getW(), cam.getH()), cam.getScreenRect());
 
   loadingScreen.updateAndRender("Initializing content generator", 38);
 
@@ -98,10 +141,41 @@ void Engine::init(LoadingScreen& loadingScreen) {
 
   loadingScreen.updateAndRender("Generating herds", 60);
 
-  appendNewElements(_contentGenerator.genHerd(cam.getPointedPos(), 20, Animals::DEER));
-  appendNewElements(_contentGenerator.genHerds());
+  _contentGenerator.genHerd(_herds, cam.getPointedPos(), 20, Animals::DEER);
+
+  if (_fastStart) {
+    loadingScreen.updateAndRender("Generating the chunks around the camera", 60);
+
+    // The herds of the other chunks are streamed in by update, their forests are generated when needed
+    _chunksWithoutHerds = chunksByDistance;
+
+    for (size_t i = 0; i < chunksByDistance.size(); i++) {
+      if (glm::length(getChunkCenter(chunksByDistance[i]) - cam.getPointedPos()) > ENGINE_FIRST_FRAME_RADIUS)
+        break;
+
+      // The tasks are executed in the same order, the previous ones are done as well
+      while (_terrain[chunksByDistance[i]]->hasPendingSubdivision()) {
+        SDL_Delay(1);
+        _chunkSubdivider.applyCompletedTasks();
+      }
+
+      glm::ivec2 chunkPos = _terrain[chunksByDistance[i]]->getChunkPos();
+      _terrain[chunksByDistance[i]]->setTrees(_contentGenerator.genForestsInChunk(chunkPos.x, chunkPos.y));
+
+      generateChunkHerds(chunksByDistance[i]);
+      _chunksWithoutHerds.erase(std::find(_chunksWithoutHerds.begin(), _chunksWithoutHerds.end(),
+                                          chunksByDistance[i]));
+    }
+
+    _chunkUploadScheduler.processAllUploads();
+    SDL_Log("Chunks around the camera loaded in %d ms", _startupClock.getElapsedTime());
+    return;
+  }
+
+  _contentGenerator.genHerds(_herds);
 
   _chunkSubdivider.waitForTasksToFinish();
+  _chunkSubdivider.applyCompletedTasks();
 
   loadingScreen.updateAndRender("Generating forests", 60);
 
@@ -112,67 +186,124 @@ void Engine::init(LoadingScreen& loadingScreen) {
     std::vector<igElement*> newTrees = _contentGenerator.genForestsInChunk(x,y);
     newChunks[x*NB_CHUNKS + y]->setTrees(newTrees);
   }
+
+  // The base level of every chunk is uploaded during the loading, the others on the fly
+  _chunkUploadScheduler.processAllUploads();
+
+  SDL_Log("Map loaded in %d ms", _startupClock.getElapsedTime());
 }
 
-void Engine::appendNewElements(std::vector<igMovingElement*> elems) {
+std::vector<size_t> Engine::getChunksByDistance(glm::vec2 pos) const {
+  std::vector<std::pair<float, size_t> > distances;
 
-  for (int i = 0; i < elems.size(); i++)
-    _igMovingElements.push_back(std::unique_ptr<igMovingElement>(elems[i]));
+  for (size_t i = 0; i < NB_CHUNKS*NB_CHUNKS; i++) {
+    distances.push_back(std::make_pair(glm::length(getChunkCenter(i) - pos), i));
+  }
 
-  for (int i = 0; i < elems.size(); i++) {
-    Controllable* ctrl = dynamic_cast<Controllable*>(elems[i]);
-    if (ctrl)
-      _controllableElements.insert(ctrl);
+  std::sort(distances.begin(), distances.end());
+
+  std::vector<size_t> res;
+  for (size_t i = 0; i < distances.size(); i++) {
+    res.push_back(distances[i].second);
   }
+
+  return res;
 }
 
-void Engine::updateMovingElementsStates() {
-  struct squareHashFunc {
-    size_t operator()(const glm::ivec2 &k) const {
-    size_t h1 = std::hash<int>()(k.x);
-    size_t h2 = std::hash<int>()(k.y);
-    return (h1 << 1) + h1 + h2;
+void Engine::generateChunkHerds(size_t chunk) {
+  size_t x = chunk / NB_CHUNKS;
+  size_t y = chunk - x * NB_CHUNKS;
+
+  _contentGenerator.genHerdsInChunk(_herds, x, y);
+}
+
+void Engine::streamHerds() {
+  if (_chunksWithoutHerds.empty())
+    return;
+
+  glm::vec2 pointedPos = Camera::getInstance().getPointedPos();
+
+  for (size_t n = 0; n < ENGINE_HERDS_CHUNKS_PER_FRAME && !_chunksWithoutHerds.empty(); n++) {
+    // The camera may have moved since the order was computed
+    size_t closest = 0;
+    float closestDist = MAX_COORD * 2;
+
+    for (size_t i = 0; i < _chunksWithoutHerds.size(); i++) {
+      float dist = glm::length(getChunkCenter(_chunksWithoutHerds[i]) - pointedPos);
+
+      if (dist < closestDist) {
+        closestDist = dist;
+        closest = i;
+      }
     }
-  };
 
-  float squareSize = Antilope::getStandardLineOfSight();
-  int nbSquares = MAX_COORD / squareSize;
+    generateChunkHerds(_chunksWithoutHerds[closest]);
+    _chunksWithoutHerds.erase(_chunksWithoutHerds.begin() + closest);
+  }
 
-  std::unordered_map<glm::ivec2, std::list<igMovingElement*>, squareHashFunc> sortedElements;
+  if (_chunksWithoutHerds.empty())
+    SDL_Log("Herds streamed in %d ms", _startupClock.getElapsedTime());
+}
+
+glm::vec2 Engine::getChunkCenter(size_t chunk) const {
+  return glm::vec2((chunk / NB_CHUNKS + 0.5f) * CHUNK_SIZE, (chunk % NB_CHUNKS + 0.5f) * CHUNK_SIZE);
+}
+
+void Engine::appendNewElements(std::vector<igMovingElement*> elems) {
+
+  for (int i = 0; i < elems.size(); i++)
+    elems[i]->setHandle(_igMovingElements.insert(std::unique_ptr<igMovingElement>(elems[i])));
+
+  for (int i = 0; i < elems.size(); i++) {
+    if (elems[i]->isControllable())
+      _controllableElements.insert(static_cast<Controllable*>(elems[i]));
+  }
+}
+
+void Engine::updateMovingElementsStates(const std::vector<bool>& activeChunks) {
+  FrameVector<igMovingElement*> activeElements(_tickArena);
+  activeElements.reserve(_igMovingElements.size());
+  _predators.clear();
 
   for (auto it = _igMovingElements.begin(); it != _igMovingElements.end(); it++) {
     if (!(*it)->isDead()) {
       glm::uvec2 chunkPos = ut::convertToChunkCoords((*it)->getPos());
-      if (_terrain[chunkPos.x * NB_CHUNKS + chunkPos.y]->getDisplayMovingElements()) {
-        glm::ivec2 square = glm::ivec2((*it)->getPos().x / squareSize, (*it)->getPos().y / squareSize);
 
-        sortedElements[square].push_back(it->get());
+      if (activeChunks[chunkPos.x * NB_CHUNKS + chunkPos.y]) {
+        activeElements.push_back(it->get());
+
+        if ((*it)->hasFaction(FACTION_PREDATOR))
+          _predators.push_back((*it)->getPos());
       }
     }
   }
 
-  for (auto square = sortedElements.begin(); square != sortedElements.end(); square++) {
-    std::list<igMovingElement*> elmtsInSurroundingSquares;
+  _herds.updateBehaviours(activeChunks, _predators);
 
-    for (int k = std::max(0, square->first.x-1); k <= std::min(nbSquares-1, square->first.x+1); k++) {
-    for (int l = std::max(0, square->first.y-1); l <= std::min(nbSquares-1, square->first.y+1); l++) {
-      glm::ivec2 squareCoord(k,l);
+  for (size_t i = 0; i < activeElements.size(); i++) {
+    activeElements[i]->updateState(_herds);
+  }
+}
 
-      if (sortedElements.find(squareCoord) != sortedElements.end())
-        elmtsInSurroundingSquares.insert(elmtsInSurroundingSquares.end(),
-          sortedElements.at(squareCoord).begin(), sortedElements.at(squareCoord).end());
-    }
-    }
+void Engine::simulationTick(const std::vector<bool>& activeChunks) {
+  _tickArena.reset();
 
-    // #pragma omp parallel
-    // #pragma omp single
-    {
-      for (auto elem = square->second.begin(); elem != square->second.end(); elem++)
-        // #pragma omp task firstprivate(elem)
-        (*elem)->updateState(elmtsInSurroundingSquares);
-      // #pragma omp taskwait
-    }
+  for (auto it = _igMovingElements.begin(); it != _igMovingElements.end(); it++) {
+    (*it)->beginTick();
   }
+
+  _herds.beginTick();
+
+  // Update positions of igMovingElement regardless of them being visible
+  for (auto it = _igMovingElements.begin(); it != _igMovingElements.end(); it++) {
+    (*it)->update(_msSimulationTick);
+  }
+
+  // The far herds are aggregates, the systems below only go through the animals near the camera
+  _herds.updateSimulationLod(activeChunks, _msSimulationTick);
+  _herds.move(_msSimulationTick);
+
+  updateMovingElementsStates(activeChunks);
 }
 
 void Engine::compute2DCorners() {
@@ -244,43 +375,81 @@ void Engine::updateCulling() {
   float phi   = cam.getPhi();
   float alpha = cam.getFov() * cam.getRatio() / 2.f;
 
-  std::vector<glm::vec3> camFrustumPlaneNormals;
+  _frustumPlaneNormals.clear();
   // Bottom of the view
-  camFrustumPlaneNormals.push_back(ut::carthesian(1.f, theta, phi + 90.f - cam.getFov() / 2.f));
+  _frustumPlaneNormals.push_back(ut::carthesian(1.f, theta, phi + 90.f - cam.getFov() / 2.f));
   // Top
-  camFrustumPlaneNormals.push_back(ut::carthesian(1.f, theta, phi + 90.f + cam.getFov() / 2.f) * -1.f);
+  _frustumPlaneNormals.push_back(ut::carthesian(1.f, theta, phi + 90.f + cam.getFov() / 2.f) * -1.f);
   // Right
-  camFrustumPlaneNormals.push_back(glm::rotate(
+  _frustumPlaneNormals.push_back(glm::rotate(
     ut::carthesian(1.f, theta + 90.f, 90.f),
     (float) (- alpha*RAD), ut::carthesian(1.f, theta + 180.f, 90.f - phi)));
   // Left
-  camFrustumPlaneNormals.push_back(glm::rotate(
+  _frustumPlaneNormals.push_back(glm::rotate(
     ut::carthesian(1.f, theta - 90.f, 90.f),
     (float) (alpha*RAD), ut::carthesian(1.f, theta + 180.f, 90.f - phi)));
 
   // Update terrains
-  for (int i = 0; i < NB_CHUNKS; i++) {
-    for (int j = 0; j < NB_CHUNKS; j++) {
-      _terrain[i*NB_CHUNKS + j]->computeCulling(camFrustumPlaneNormals);
+  _chunkQuadtree.refit(_terrain);
+  _chunkQuadtree.computeCulling(_frustumPlaneNormals, cam.getPos(), _terrain);
 
-      if (_terrain[i*NB_CHUNKS + j]->isVisible())
-        _terrain[i*NB_CHUNKS + j]->computeDistanceOptimizations();
-    }
+  for (int i = 0; i < NB_CHUNKS*NB_CHUNKS; i++) {
+    if (_terrain[i]->isVisible())
+      _terrain[i]->computeDistanceOptimizations();
+  }
+
+  // The nearest chunks fill the depth buffer first, so that the early depth test rejects
+  // the fragments of the chunks they hide
+  FrameVector<std::pair<float, size_t> > distances(_frameArena);
+  distances.reserve(_terrain.size());
+
+  for (size_t i = 0; i < _terrain.size(); i++) {
+    if (_terrain[i]->isVisible())
+      distances.push_back(std::make_pair(glm::length(_terrain[i]->getCenter() - cam.getPos()), i));
+  }
+
+  if (_frontToBack)
+    std::sort(distances.begin(), distances.end());
+
+  _terrainDrawOrder.clear();
+  for (size_t i = 0; i < distances.size(); i++) {
+    _terrainDrawOrder.push_back(distances[i].second);
   }
 }
 
 void Engine::update(int msElapsed) {
+  waitForSimulation();
+  _frameArena.reset();
+
+  // _globalFBO still contains the previous frame, whose depth under the cursor is read asynchronously
+  int mousePosX, mousePosY;
+  SDL_GetMouseState(&mousePosX, &mousePosY);
+  _picker.update(getFBOCoord(glm::ivec2(mousePosX, mousePosY)), _renderedViewProjection);
+  _renderedViewProjection = Camera::getInstance().getViewProjectionMatrix();
+
+  _chunkLodCache.newFrame();
+  // The only point where the levels generated by the subdivider thread are published
+  _chunkSubdivider.applyCompletedTasks();
+  _chunkUploadScheduler.processUploads();
+  streamHerds();
   updateCulling();
+  _chunkPrefetcher.update(msElapsed, _terrain);
+  _chunkLodCache.enforceBudgets(_terrain);
+  _occlusionCuller.computeOcclusion(_terrain, Camera::getInstance().getViewProjectionMatrix());
+  _forestImpostorBaker.update(_terrain, _igEShader);
 
-  // Update positions of igMovingElement regardless of them being visible
-  for (auto it = _igMovingElements.begin(); it != _igMovingElements.end(); it++) {
-    (*it)->update(msElapsed);
+  for (size_t i = 0; i < _activeChunks.size(); i++) {
+    _activeChunks[i] = _terrain[i]->getDisplayMovingElements();
   }
 
-  updateMovingElementsStates();
+  // The state was simulated during the previous frame, with the time elapsed until then. The
+  // fraction of the next tick already elapsed tells how far the display is between the last two ticks
+  float alpha = _msSimulationLag / (float) _msSimulationTick;
+
+  _herds.updateAnimations(msElapsed);
 
   // Fill the visible elements
-  std::vector<igElement*> visibleElmts;
+  _visibleElmts.clear();
 
   // Update graphics of visible elements
   Camera& cam = Camera::getInstance();
@@ -289,21 +458,36 @@ void Engine::update(int msElapsed) {
     glm::uvec2 chunkPos = ut::convertToChunkCoords((*it)->getPos());
 
     if (_terrain[chunkPos.x*NB_CHUNKS + chunkPos.y]->isVisible() &&
+        !_terrain[chunkPos.x*NB_CHUNKS + chunkPos.y]->isContentOccluded() &&
         _terrain[chunkPos.x*NB_CHUNKS + chunkPos.y]->getDisplayMovingElements()) {
 
-      float height = _terrain[chunkPos.x*NB_CHUNKS + chunkPos.y]->getHeight((*it)->getPos());
+      glm::vec2 displayedPos = (*it)->getDisplayedPos(alpha);
 
-      (*it)->setHeight(height);
+      (*it)->setDisplayedPos(displayedPos, getHeight(displayedPos));
       (*it)->updateDisplay(msElapsed, cam.getTheta());
 
-      visibleElmts.push_back(it->get());
+      _visibleElmts.push_back(it->get());
     }
   }
 
-  _igElementDisplay.loadElements(visibleElmts);
+  for (size_t i = 0; i < _visibleChunks.size(); i++) {
+    _visibleChunks[i] = _terrain[i]->isVisible() && !_terrain[i]->isContentOccluded() &&
+                        _terrain[i]->getDisplayMovingElements();
+  }
+
+  _herdSprites.clear();
+  _herds.appendSprites(_visibleChunks, cam.getTheta(), alpha, _herdSprites);
+
+  for (size_t i = 0; i < _herdSprites.size(); i++) {
+    glm::uvec2 chunkPos = ut::convertToChunkCoords(glm::vec2(_herdSprites[i].pos));
+    _herdSprites[i].pos.z = _terrain[chunkPos.x*NB_CHUNKS + chunkPos.y]->getHeight(glm::vec2(_herdSprites[i].pos));
+  }
+
+  _igElementDisplay.prepareElements(_visibleElmts, _herdSprites);
+  _igElementDisplay.uploadElements();
 
   // Remove the dead elements from the controllable elements
-  std::vector<Controllable*> toDelete;
+  FrameVector<Controllable*> toDelete(_frameArena);
   for (auto it = _controllableElements.begin(); it != _controllableElements.end(); it++) {
    if ((*it)->isDead())
      toDelete.push_back(*it);
@@ -315,17 +499,64 @@ void Engine::update(int msElapsed) {
 
   compute2DCorners();
 
-  Log& logText = Log::getInstance();
-  std::ostringstream renderStats;
-  renderStats << "Moving elements: " << visibleElmts.size() << std::endl;
-  logText.addLine(renderStats.str());
+  std::ostream& renderStats = Log::getInstance().getStream();
+  if (!_chunksWithoutHerds.empty())
+    renderStats << "Chunks waiting for herds: " << _chunksWithoutHerds.size() << std::endl;
+
+  renderStats << "Simulation ticks: " << _nbTicksLastFrame << " in " << _simulationThread.getMsLastJob() << " ms" << std::endl
+              << "Heap allocations of the ticks: " << _nbTickAllocations << std::endl
+              << "Moving elements: " << _visibleElmts.size() + _herdSprites.size() << std::endl
+              << "Herd animals (alive/total): " << _herds.getNbAlive() << "/" << _herds.size() << std::endl
+              << "Herd animals (evaluated/simulated): " << _herds.getNbEvaluated() << "/" << _herds.getNbSimulated() << std::endl
+              << "Collapsed herds: " << _herds.getNbCollapsedHerds() << "/" << _herds.getNbHerds() << std::endl
+              << "Herd neighbour lists builds: " << _herds.getNbNeighbourListsBuilds() << std::endl
+              << "Culling nodes tested: " << _chunkQuadtree.getNbNodesTested() << std::endl
+              << "Occluded chunks (terrain/content): " << _occlusionCuller.getNbChunksCulled() << "/"
+                                                       << _occlusionCuller.getNbContentsCulled() << std::endl;
+
+  // Fixed ticks: the results do not depend on the frame rate, and no step is long enough to jump over water
+  _msSimulationLag += msElapsed;
+  _nbTicksPending = _msSimulationLag / _msSimulationTick;
+
+  if (_nbTicksPending > ENGINE_MAX_TICKS_PER_FRAME) {
+    _nbTicksPending = ENGINE_MAX_TICKS_PER_FRAME;
+    _msSimulationLag = 0;
+  }
+
+  else
+    _msSimulationLag -= _nbTicksPending * _msSimulationTick;
+
+  _simulatedChunks = _activeChunks;
+}
+
+void Engine::startSimulation() {
+  _nbTicksLastFrame = _nbTicksPending;
+  _nbTicksPending = 0;
+
+  if (_nbTicksLastFrame == 0)
+    return;
+
+  // The job only touches the moving elements and the herds, the rest of the engine stays on the main thread
+  _simulationThread.start([this]() {
+    size_t nbAllocationsBefore = ut::getNbAllocations();
+
+    for (size_t i = 0; i < _nbTicksLastFrame; i++) {
+      simulationTick(_simulatedChunks);
+    }
+
+    _nbTickAllocations = ut::getNbAllocations() - nbAllocationsBefore;
+  });
 }
 
 void Engine::renderToFBO() const {
   size_t nbTriangles = 0;
   size_t nbElements = 0;
+  size_t nbImpostors = 0;
 
-  _globalFBO.bind();
+  if (_singlePassSprites)
+    _multisampleFBO.bind();
+  else
+    _globalFBO.bind();
 
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
@@ -353,6 +584,10 @@ void Engine::renderToFBO() const {
 	glUniformMatrix4fv(_terrainShader.getUniformLocation("MVP"),
     1, GL_FALSE, &MVP[0][0]);
 
+  // The ocean has no coarser shape to morph from
+  GLint morphFactorLocation = _terrainShader.getUniformLocation("morphFactor");
+  glUniform1f(morphFactorLocation, 1.f);
+
   // Background Ocean
 
   glDisable(GL_DEPTH_TEST);
@@ -367,13 +602,29 @@ void Engine::renderToFBO() const {
     glPolygonMode( GL_FRONT_AND_BACK, GL_LINE );
 #endif
 
-  for (int i = 0; i < NB_CHUNKS; i++) {
-    for (int j = 0; j < NB_CHUNKS; j++) {
-      if (_terrain[i*NB_CHUNKS + j]->isVisible())
-        nbTriangles += _terrain[i*NB_CHUNKS + j]->draw();
+  if (_overdrawView) {
+    // Only the terrain is measured
+    glClear(GL_COLOR_BUFFER_BIT);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE, GL_ONE);
+  }
+
+  glUniform1i(_terrainShader.getUniformLocation("overdrawView"), _overdrawView);
+
+  for (size_t i = 0; i < _terrainDrawOrder.size(); i++) {
+    const Chunk& chunk = *_terrain[_terrainDrawOrder[i]];
+
+    if (!chunk.isTerrainOccluded()) {
+      glUniform1f(morphFactorLocation, chunk.getMorphFactor());
+      nbTriangles += chunk.draw();
     }
   }
 
+  if (_overdrawView) {
+    glUniform1i(_terrainShader.getUniformLocation("overdrawView"), false);
+    glDisable(GL_BLEND);
+  }
+
 #ifndef __ANDROID__
   if (_wireframe)
     glPolygonMode( GL_FRONT_AND_BACK, GL_FILL );
@@ -399,55 +650,116 @@ void Engine::renderToFBO() const {
   glUniform3fv(_igEShader.getUniformLocation("camPos"),
     1, &cam.getPos()[0]);
 
-  // Two passes to avoid artifacts due to alpha blending
+  if (_singlePassSprites) {
+    // Each sprite is drawn once, its alpha gives the fraction of the samples it covers
+    glUniform1i(_igEShader.getUniformLocation("onlyOpaqueParts"), false);
+    glEnable(GL_SAMPLE_ALPHA_TO_COVERAGE);
 
-  glUniform1i(_igEShader.getUniformLocation("onlyOpaqueParts"), true);
-  _igElementDisplay.drawElements();
+    _igElementDisplay.drawElements();
+    drawForests(nbElements, nbImpostors);
 
-  for (int i = 0; i < NB_CHUNKS; i++) {
-    for (int j = 0; j < NB_CHUNKS; j++) {
-      if (_terrain[i*NB_CHUNKS + j]->isVisible() &&
-          _terrain[i*NB_CHUNKS + j]->getTreesNeedTwoPasses())
-        _terrain[i*NB_CHUNKS + j]->drawTrees();
-    }
+    glDisable(GL_SAMPLE_ALPHA_TO_COVERAGE);
   }
 
-  glUniform1i(_igEShader.getUniformLocation("onlyOpaqueParts"), false);
-
-  glEnable (GL_BLEND);
-  glBlendFunc (GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+  else {
+    // Two passes to avoid artifacts due to alpha blending
 
-  _igElementDisplay.drawElements();
+    glUniform1i(_igEShader.getUniformLocation("onlyOpaqueParts"), true);
+    _igElementDisplay.drawElements();
 
-  for (int i = 0; i < NB_CHUNKS; i++) {
-    for (int j = 0; j < NB_CHUNKS; j++) {
-      if (_terrain[i*NB_CHUNKS + j]->isVisible())
-        nbElements += _terrain[i*NB_CHUNKS + j]->drawTrees();
+    for (int i = 0; i < NB_CHUNKS; i++) {
+      for (int j = 0; j < NB_CHUNKS; j++) {
+        if (_terrain[i*NB_CHUNKS + j]->isVisible() &&
+            !_terrain[i*NB_CHUNKS + j]->isContentOccluded() &&
+            _terrain[i*NB_CHUNKS + j]->getTreesNeedTwoPasses())
+          _terrain[i*NB_CHUNKS + j]->drawTrees();
+      }
     }
-  }
 
-  glDisable(GL_BLEND);
+    glUniform1i(_igEShader.getUniformLocation("onlyOpaqueParts"), false);
+
+    glEnable (GL_BLEND);
+    glBlendFunc (GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    _igElementDisplay.drawElements();
+    drawForests(nbElements, nbImpostors);
+
+    glDisable(GL_BLEND);
+  }
 
   Shader::unbind();
   FrameBufferObject::unbind();
 
-  Log& logText = Log::getInstance();
+  if (_singlePassSprites)
+    _multisampleFBO.resolveInto(_globalFBO);
 
-  std::ostringstream renderStats;
+  size_t nbForests = 0;
+  for (size_t i = 0; i < _terrain.size(); i++) {
+    if (_terrain[i]->isForestReceived())
+      nbForests++;
+  }
+
+  std::ostream& renderStats = Log::getInstance().getStream();
   renderStats << "Triangles: " << nbTriangles << std::endl
-              << "Trees:  " << nbElements << std::endl
-              << "Chunks waiting for subdivision: " << _chunkSubdivider.getNbTasksInQueue() << std::endl;
+              << "Picks (GPU/ray march): " << _nbGPUPicks << "/" << _nbRayMarchPicks << std::endl
+              << "Terrain order: " << (_frontToBack ? "front to back" : "fixed") << std::endl
+              << "Sprites: " << (_singlePassSprites ? "single pass (alpha to coverage)" : "two passes") << std::endl
+              << "Trees:  " << nbElements << ", impostors: " << nbImpostors << std::endl
+              << "Chunks with impostors: " << _forestImpostorBaker.getNbChunksBaked() << std::endl
+              << "Forests generated: " << nbForests << "/" << _terrain.size() << std::endl
+              << "Chunks waiting for subdivision: " << _chunkSubdivider.getNbTasksInQueue() << std::endl
+              << "LODs memory (CPU/GPU): " << _chunkLodCache.getCPUMemory() / (1024*1024) << "/"
+                                           << _chunkLodCache.getGPUMemory() / (1024*1024) << " MB" << std::endl
+              << "LODs evicted/regenerated: " << _chunkLodCache.getNbEvictions() << "/"
+                                              << _chunkLodCache.getNbRegenerations() << std::endl
+              << "LOD uploads: " << _chunkUploadScheduler.getLastBytesUploaded() / 1024 << " KB in "
+                                 << _chunkUploadScheduler.getLastUploadTime() << " ms, "
+                                 << _chunkUploadScheduler.getNbPendingUploads() << " waiting" << std::endl
+              << "LODs prefetched: " << _chunkPrefetcher.getNbLevelsPrefetched() << ", hit rate "
+                                     << (int) (100 * _chunkPrefetcher.getHitRate()) << "%" << std::endl;
+}
+
+void Engine::drawForests(size_t& nbTrees, size_t& nbImpostors) const {
+  // The trees and the impostors of a chunk share the fragments according to the blend
+  GLint keptRangeLocation = _igEShader.getUniformLocation("keptRange");
+
+  for (int i = 0; i < NB_CHUNKS; i++) {
+    for (int j = 0; j < NB_CHUNKS; j++) {
+      if (_terrain[i*NB_CHUNKS + j]->isVisible() &&
+          !_terrain[i*NB_CHUNKS + j]->isContentOccluded()) {
+        float impostorBlend = _terrain[i*NB_CHUNKS + j]->getImpostorBlend();
+
+        if (impostorBlend < 1.f) {
+          glUniform2f(keptRangeLocation, impostorBlend, 2.f);
+          nbTrees += _terrain[i*NB_CHUNKS + j]->drawTrees();
+        }
+
+        if (impostorBlend > 0.f) {
+          glUniform2f(keptRangeLocation, 0.f, impostorBlend);
+          nbImpostors += _terrain[i*NB_CHUNKS + j]->drawImpostors();
+        }
+      }
+    }
+  }
 
-  logText.addLine(renderStats.str());
+  glUniform2f(keptRangeLocation, 0.f, 2.f);
+}
+
+void Engine::switchSpriteRendering() {
+  _singlePassSprites = !_singlePassSprites;
+
+  // Only allocated if the path is used
+  if (_singlePassSprites && !_multisampleFBO.isInitialized()) {
+    Camera& cam = Camera::getInstance();
+    _multisampleFBO.initMultisample(cam.getW(), cam.getH(), ENGINE_MSAA_SAMPLES, GL_RGBA8);
+  }
 }
 
 void Engine::addLion(glm::ivec2 screenTarget, float minDistToAntilopes) {
   glm::vec2 lionPos = get2DCoord(screenTarget);
-  for (auto it = _igMovingElements.begin(); it != _igMovingElements.end(); it++) {
-    Antilope* atlp = dynamic_cast<Antilope*>(it->get());
-    if (atlp && !atlp->isDead() && glm::length(atlp->getPos() - lionPos) < minDistToAntilopes)
-      throw std::runtime_error("Can't spawn a predator here, too close to its preys");
-  }
+  if (_herds.hasAliveAnimalWithin(lionPos, minDistToAntilopes))
+    throw std::runtime_error("Can't spawn a predator here, too close to its preys");
+
   std::vector<igMovingElement*> newLion = _contentGenerator.genLion(lionPos);
 
   if (newLion.size() == 0)
@@ -456,61 +768,51 @@ void Engine::addLion(glm::ivec2 screenTarget, float minDistToAntilopes) {
   appendNewElements(newLion);
 }
 
-std::vector<Controllable*> Engine::genTribe(glm::ivec2 screenTarget) {
+std::vector<SlotHandle> Engine::genTribe(glm::ivec2 screenTarget) {
   glm::vec2 pos = get2DCoord(screenTarget);
   std::vector<igMovingElement*> tribe = _contentGenerator.genTribe(pos);
   appendNewElements(tribe);
 
-  std::vector<Controllable*> res;
+  std::vector<SlotHandle> res;
   for (int i = 0; i < tribe.size(); i++) {
-    res.push_back(dynamic_cast<Controllable*>(tribe[i]));
+    res.push_back(tribe[i]->getHandle());
   }
 
   return res;
 }
 
-void Engine::deleteElements(const std::vector<igMovingElement*>& elementsToDelete) {
-  for (auto elmt = _igMovingElements.begin(); elmt != _igMovingElements.end(); ) {
-    bool hasDeleted = false;
-    for (auto toDel = elementsToDelete.begin(); toDel != elementsToDelete.end(); toDel++) {
-      if ((*toDel) == elmt->get()) {
-        elmt = _igMovingElements.erase(elmt);
-        hasDeleted = true;
-      }
+void Engine::deleteElements(const std::vector<SlotHandle>& elementsToDelete) {
+  for (size_t i = 0; i < elementsToDelete.size(); i++) {
+    Controllable* ctrl = getControllable(elementsToDelete[i]);
+
+    if (ctrl) {
+      _controllableElements.erase(ctrl);
+      _deadControllableElements.erase(ctrl);
     }
 
-    if (!hasDeleted)
-      elmt++;
+    _igMovingElements.erase(elementsToDelete[i]);
   }
+}
 
-  for (auto elmt = _controllableElements.begin(); elmt != _controllableElements.end(); ) {
-    bool hasDeleted = false;
-    for (auto toDel = elementsToDelete.begin(); toDel != elementsToDelete.end(); toDel++) {
-      if (*toDel == *elmt) {
-        elmt = _controllableElements.erase(elmt);
-        hasDeleted = true;
-      }
-    }
+glm::vec2 Engine::get2DCoord(glm::ivec2 screenTarget) {
+  Camera& cam = Camera::getInstance();
+  glm::ivec2 fboTarget = getFBOCoord(screenTarget);
 
-    if (!hasDeleted)
-      elmt++;
-  }
+  // The GPU result is only available if the cursor has stayed on the pixel for a frame or two
+  glm::vec3 modelCoord;
 
-  for (auto elmt = _deadControllableElements.begin(); elmt != _deadControllableElements.end(); ) {
-    bool hasDeleted = false;
-    for (auto toDel = elementsToDelete.begin(); toDel != elementsToDelete.end(); toDel++) {
-      if (*toDel == *elmt) {
-        elmt = _deadControllableElements.erase(elmt);
-        hasDeleted = true;
-      }
-    }
+  if (_picker.getPickedPos(fboTarget, cam.getViewProjectionMatrix(), modelCoord))
+    _nbGPUPicks++;
 
-    if (!hasDeleted)
-      elmt++;
+  else {
+    modelCoord = rayMarchTerrain(fboTarget);
+    _nbRayMarchPicks++;
   }
+
+  return glm::vec2( modelCoord.x, modelCoord.y);
 }
 
-glm::vec2 Engine::get2DCoord(glm::ivec2 screenTarget) {
+glm::ivec2 Engine::getFBOCoord(glm::ivec2 screenTarget) const {
   Camera& cam = Camera::getInstance();
 
   screenTarget = glm::ivec2(screenTarget.x * cam.getW() / cam.getWindowW(),
@@ -518,26 +820,50 @@ glm::vec2 Engine::get2DCoord(glm::ivec2 screenTarget) {
 
   screenTarget.y = cam.getH() - screenTarget.y; // Inverted coordinates
 
-  _depthInColorBufferFBO.bind();
-  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+  return screenTarget;
+}
 
-  _depthInColorBufferShader.bind();
-  _depthTexturedRectangle->draw();
-  Shader::unbind();
+glm::vec3 Engine::rayMarchTerrain(glm::ivec2 fboTarget) const {
+  Camera& cam = Camera::getInstance();
+  glm::vec4 viewport(0, 0, cam.getW(), cam.getH());
 
-  GLubyte depthBytes[4];
-  glReadPixels(screenTarget.x, screenTarget.y, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, &depthBytes[0]);
+  glm::vec3 nearPoint = glm::unProject(glm::vec3(fboTarget, 0.f), glm::mat4(1.f), cam.getViewProjectionMatrix(), viewport);
+  glm::vec3 farPoint  = glm::unProject(glm::vec3(fboTarget, 1.f), glm::mat4(1.f), cam.getViewProjectionMatrix(), viewport);
 
-  FrameBufferObject::unbind();
+  glm::vec3 dir = glm::normalize(farPoint - nearPoint);
+  float maxDist = glm::length(farPoint - nearPoint);
 
-  const glm::vec4 bit_shift = glm::vec4(1.0/(256.0*256.0*256.0), 1.0/(256.0*256.0), 1.0/256.0, 1.0);
-  float depth = glm::dot(glm::vec4(depthBytes[0], depthBytes[1], depthBytes[2], depthBytes[3]) / 255.f, bit_shift);
+  float dist = 0.f;
+  float lastStep = 0.f;
 
-  glm::vec3 modelCoord = glm::unProject(glm::vec3(screenTarget.x, screenTarget.y,depth),
-    glm::mat4(1.f), cam.getViewProjectionMatrix(),
-    glm::vec4(0,0, cam.getW(), cam.getH()));
+  while (dist < maxDist) {
+    glm::vec3 point = nearPoint + dist * dir;
+    // The height is 0 outside of the map, where the ocean is
+    float heightAbove = point.z - getHeight(glm::vec2(point));
 
-  return glm::vec2( modelCoord.x, modelCoord.y);
+    if (heightAbove <= 0.f) {
+      float above = dist - lastStep;
+      float below = dist;
+
+      for (int i = 0; i < ENGINE_PICKING_REFINEMENTS; i++) {
+        float middle = (above + below) / 2.f;
+        glm::vec3 middlePoint = nearPoint + middle * dir;
+
+        if (middlePoint.z > getHeight(glm::vec2(middlePoint)))
+          above = middle;
+        else
+          below = middle;
+      }
+
+      return nearPoint + below * dir;
+    }
+
+    lastStep = std::max(ENGINE_PICKING_MIN_STEP, ENGINE_PICKING_STEP_FACTOR * heightAbove);
+    dist += lastStep;
+  }
+
+  // Towards the sky
+  return farPoint;
 }
 
 glm::vec3 Engine::getNormalOnCameraPointedPos() const {
@@ -7,7 +7,7 @@
 #include <unordered_set>
 #include <vector>
 
-#include "antilope.h"
+#include "herdStore.h"
 #include "lion.h"
 #include "tree.h"
 #include "igElementDisplay.h"
@@ -16,8 +16,14 @@
 #include "texturedRectangle.h"
 
 #include "chunk.h"
+#include "chunkLodCache.h"
+#include "chunkPrefetcher.h"
+#include "chunkQuadtree.h"
+#include "chunkUploadScheduler.h"
+#include "occlusionCuller.h"
 #include "chunkSubdivider.h"
 #include "contentGenerator.h"
+#include "forestImpostorBaker.h"
 #include "map.h"
 #include "ocean.h"
 #include "skybox.h"
@@ -27,13 +33,31 @@
 
 #include "terrainTexManager.h"
 
+#include "asyncPicker.h"
 #include "frameBufferObject.h"
 #include "shader.h"
 
+#include "clock.h"
+#include "frameArena.h"
+#include "simulationThread.h"
+#include "slotMap.h"
+
 #ifndef NDEBUG
 	class TestHandler;
 #endif
 
+// The first frame is displayed as soon as the chunks around the camera are ready,
+// the rest of the map is streamed in afterwards
+#define ENGINE_FAST_START true
+// Samples of the framebuffer used when the sprites are rendered in a single pass with alpha to coverage
+#define ENGINE_MSAA_SAMPLES 4
+// Step of the simulation of the moving elements, independent of the frame rate. The systems
+// take whole ms, so the rate is 30.3 Hz rather than 30: the lag is counted with the same step,
+// the simulated time keeps up with the real one
+#define ENGINE_MS_SIMULATION_TICK 33
+// Beyond this number of ticks in a frame, the simulation slows down instead of freezing the display
+#define ENGINE_MAX_TICKS_PER_FRAME 5
+
 class Engine {
 
 #ifndef NDEBUG
@@ -48,21 +72,46 @@ public:
 
   void init(LoadingScreen& loadingScreen);
 
+	// Prepares the display of the state simulated during the previous frame, and counts the
+	// simulation ticks reached by msElapsed, which startSimulation runs on the simulation thread
 	void update(int msElapsed);
+	void startSimulation();
+	// The moving elements and the herds must not be read or modified between startSimulation and this
+	inline void waitForSimulation() {_simulationThread.wait();}
 	void renderToFBO() const;
 	void moveSelection(glm::ivec2 screenTarget);
 	void addLion(glm::ivec2 screenTarget, float minDistToAntilopes = 0);
-	std::vector<Controllable*> genTribe(glm::ivec2 screenTarget);
-	void deleteElements(const std::vector<igMovingElement*>& elementsToDelete);
+	std::vector<SlotHandle> genTribe(glm::ivec2 screenTarget);
+	// The handles already deleted are ignored
+	void deleteElements(const std::vector<SlotHandle>& elementsToDelete);
 
 	inline void switchWireframe() {_wireframe = !_wireframe;}
-	inline void waitForTasksToFinish() {_chunkSubdivider.waitForTasksToFinish();}
-
-	inline const std::set<Controllable*>& getControllableElements() {return _controllableElements;}
-	inline const std::set<Controllable*>& getDeadControllableElements() {return _deadControllableElements;}
+	inline void switchOcclusionCulling() {_occlusionCuller.switchEnabled();}
+	inline void switchPrefetching() {_chunkPrefetcher.switchEnabled();}
+	// Between two passes (opaque parts, then blended) and a single pass with alpha to coverage
+	void switchSpriteRendering();
+	inline void switchFrontToBack() {_frontToBack = !_frontToBack;}
+	inline void switchOverdrawView() {_overdrawView = !_overdrawView;}
+	inline void prefetchAround(glm::vec2 pos) {_chunkPrefetcher.setJumpTarget(pos);}
+	inline void waitForTasksToFinish() {_chunkSubdivider.waitForTasksToFinish(); _chunkSubdivider.applyCompletedTasks();}
+	inline void setLodMemoryBudgets(size_t cpuBudget, size_t gpuBudget) {_chunkLodCache.setBudgets(cpuBudget, gpuBudget);}
+	inline void setLodUploadBudgets(size_t bytesBudget, float msBudget) {_chunkUploadScheduler.setBudgets(bytesBudget, msBudget);}
+
+	inline const std::unordered_set<Controllable*>& getControllableElements() {return _controllableElements;}
+	inline const std::unordered_set<Controllable*>& getDeadControllableElements() {return _deadControllableElements;}
+	// nullptr if the element has been deleted
+	inline igMovingElement* getElement(SlotHandle handle) const {
+		const std::unique_ptr<igMovingElement>* elmt = _igMovingElements.get(handle);
+		return elmt ? elmt->get() : nullptr;
+	}
+	inline Controllable* getControllable(SlotHandle handle) const {
+		igMovingElement* elmt = getElement(handle);
+		return elmt && elmt->isControllable() ? static_cast<Controllable*>(elmt) : nullptr;
+	}
 	inline const Texture* getColorBuffer() const {return _globalFBO.getColorBuffer();}
 
 	inline bool isChunkVisible(size_t x, size_t y) const {return _terrain[x*NB_CHUNKS + y]->isVisible();}
+	inline bool isFastStart() const {return _fastStart;}
 
 	glm::vec2 get2DCoord(glm::ivec2 screenTarget);
 	glm::vec3 getNormalOnCameraPointedPos() const;
@@ -70,19 +119,43 @@ public:
 
 private:
   void appendNewElements(std::vector<igMovingElement*> elems);
-	// The parameter contains a list of the moving elements in the chunk (x,y) in index x * NB_CHUNKS + y
-  void updateMovingElementsStates();
+  // Reactions of the herds and of the other moving elements of the active chunks, the ones displaying them
+  void updateMovingElementsStates(const std::vector<bool>& activeChunks);
+  // Moves the herds and the moving elements by _msSimulationTick
+  void simulationTick(const std::vector<bool>& activeChunks);
 	void updateCulling();
 	void compute2DCorners();
+	glm::vec2 getChunkCenter(size_t chunk) const;
+	// Indices of the chunks sorted by distance to pos
+	std::vector<size_t> getChunksByDistance(glm::vec2 pos) const;
+	void generateChunkHerds(size_t chunk);
+	// Generates the herds of the closest chunks that do not have them yet
+	void streamHerds();
+	// Draws the trees and impostors of the visible chunks, with the crossfade between them
+	void drawForests(size_t& nbTrees, size_t& nbImpostors) const;
+	// Converts window coordinates into the ones of _globalFBO, with the origin at the bottom
+	glm::ivec2 getFBOCoord(glm::ivec2 screenTarget) const;
+	// Intersection of the ray through the pixel with the displayed terrain, computed on the CPU
+	glm::vec3 rayMarchTerrain(glm::ivec2 fboTarget) const;
 
 	bool _wireframe;
-
-  std::list<std::unique_ptr<igMovingElement> > _igMovingElements;
+	bool _singlePassSprites;
+	bool _frontToBack;
+	bool _overdrawView;
+	// Visible chunks, sorted front to back unless disabled
+	std::vector<size_t> _terrainDrawOrder;
+	bool _fastStart;
+	Clock _startupClock;
+	std::vector<size_t> _chunksWithoutHerds;
+
+  SlotMap<std::unique_ptr<igMovingElement> > _igMovingElements;
+	// The herd animals are not igMovingElements, there are far more of them
+	HerdStore _herds;
 
   // Raw pointers because the ownership is in _igMovingElements
 	// Static elements are stored in chunks
-  std::set<Controllable*> _controllableElements;
-	std::set<Controllable*> _deadControllableElements;
+  std::unordered_set<Controllable*> _controllableElements;
+	std::unordered_set<Controllable*> _deadControllableElements;
 
 	igElementDisplay _igElementDisplay;
   ContentGenerator _contentGenerator;
@@ -101,10 +174,40 @@ private:
 	Shader _skyboxShader;
 
 	ChunkSubdivider _chunkSubdivider;
+	ChunkLodCache _chunkLodCache;
+	ChunkUploadScheduler _chunkUploadScheduler;
+	ChunkPrefetcher _chunkPrefetcher;
+	ChunkQuadtree _chunkQuadtree;
+	OcclusionCuller _occlusionCuller;
 	std::vector<std::unique_ptr<Chunk> > _terrain;
+	ForestImpostorBaker _forestImpostorBaker;
 
-	Shader _depthInColorBufferShader;
 	FrameBufferObject _globalFBO;
-	FrameBufferObject _depthInColorBufferFBO;
-	std::unique_ptr<TexturedRectangle> _depthTexturedRectangle;
+	// Rendered into instead of _globalFBO and resolved into it in single pass sprite rendering
+	FrameBufferObject _multisampleFBO;
+
+	AsyncPicker _picker;
+	glm::mat4 _renderedViewProjection; // Of the last frame rendered in _globalFBO
+	size_t _nbGPUPicks;
+	size_t _nbRayMarchPicks;
+
+	const int _msSimulationTick;
+	int _msSimulationLag; // Elapsed time not simulated yet, less than a tick
+	size_t _nbTicksLastFrame;
+	size_t _nbTicksPending; // Counted by update, run by startSimulation
+	std::vector<bool> _simulatedChunks; // Active chunks of the pending ticks
+	SimulationThread _simulationThread;
+
+	// The transient containers of a frame draw from the arena of their thread, the ones
+	// passed to other classes are members cleared each frame, which keeps their memory
+	FrameArena _frameArena; // Main thread, reset by update
+	FrameArena _tickArena; // Simulation thread, reset by each tick
+	std::vector<bool> _activeChunks;
+	std::vector<bool> _visibleChunks;
+	std::vector<igElement*> _visibleElmts;
+	std::vector<Sprite> _herdSprites;
+	std::vector<glm::vec3> _frustumPlaneNormals;
+	std::vector<glm::vec2> _predators; // Simulation thread
+	// Heap allocations of the ticks of the last frame, counted in debug builds
+	size_t _nbTickAllocations;
 };
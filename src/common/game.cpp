@@ -1,4 +1,5 @@
 #include "game.h"
+#include "allocationCounter.h"
 #include "camera.h"
 #include "log.h"
 
@@ -7,7 +8,7 @@
 #define LION_MIN_SPAWN_DIST 20
 
 Game::Game (Engine& engine):
-  _focusedCharacter(nullptr),
+  _focusedCharacter(INVALID_SLOT_HANDLE),
   _lockedView(false),
   _displayLog(true),
   _engine(engine),
@@ -19,7 +20,8 @@ Game::Game (Engine& engine):
   _nbLions(0),
   _bestScore(0),
   _msHuntDuration(120000),
-  _msCenterTextDisplayDuration(1000) {}
+  _msCenterTextDisplayDuration(1000),
+  _nbUpdateAllocations(0) {}
 
 void Game::init(LoadingScreen& loadingScreen) {
   loadingScreen.updateAndRender("Initializing interface", 80);
@@ -38,7 +40,11 @@ void Game::init(LoadingScreen& loadingScreen) {
   _popupMenu.addEntry("Tribe", &Game::genTribe);
 
   update(0);
-  _engine.waitForTasksToFinish();
+
+  // In fast start, the levels asked by the first update are displayed when they arrive
+  if (!_engine.isFastStart())
+    _engine.waitForTasksToFinish();
+
   loadingScreen.updateAndRender("Finished initialization", 100);
 }
 
@@ -62,6 +68,12 @@ void Game::updateCamera() const {
 }
 
 void Game::update(int msElapsed) {
+  // The selection below reads the moving elements, whatever the caller they must be back from the ticks
+  _engine.waitForSimulation();
+
+  // The whole update is counted, the log included
+  size_t nbAllocationsBefore = ut::getNbAllocations();
+
   Log& logText = Log::getInstance();
   logText.addFPSandCamInfo();
 
@@ -71,6 +83,7 @@ void Game::update(int msElapsed) {
     _interface.setTextTopRight("");
 
   logText.clear();
+  logText.getStream() << "Heap allocations of the last update: " << _nbUpdateAllocations << std::endl;
 
 #ifndef __ANDROID__
   if (Clock::isGlobalTimerPaused())
@@ -84,21 +97,35 @@ void Game::update(int msElapsed) {
   if (_huntHasStarted)
     _interface.setTextTopRight(getHuntText());
 
-  // Remove the dead elements from the selected elements
-  std::vector<Lion*> toDelete;
-  for (auto it = _selection.begin(); it != _selection.end(); it++) {
-   if ((*it)->isDead())
-     toDelete.push_back(*it);
-  }
-  for (int i = 0; i < toDelete.size(); i++) {
-   _selection.erase(toDelete[i]);
+  // Remove the dead and deleted elements from the selected elements
+  for (auto it = _selection.begin(); it != _selection.end(); ) {
+    igMovingElement* elmt = _engine.getElement(*it);
+
+    if (!elmt || elmt->isDead())
+      it = _selection.erase(it);
+    else
+      it++;
   }
 
-  if (_focusedCharacter != nullptr && _focusedCharacter->isDead())
-    _focusedCharacter = nullptr;
+  if (hasFocusedCharacter() && getFocusedCharacter()->isDead())
+    _focusedCharacter = INVALID_SLOT_HANDLE;
 
   updateCamera();
   _engine.update(msElapsed);
+
+  _staminaBars.clear();
+  getSelectedLions(_selectedLions);
+
+  for (size_t i = 0; i < _selectedLions.size(); i++) {
+    _staminaBars.push_back(StaminaBar{_selectedLions[i]->getScreenRect(),
+                                      _selectedLions[i]->getMaxHeightFactor(),
+                                      _selectedLions[i]->getStamina()});
+  }
+
+  _nbUpdateAllocations = ut::getNbAllocations() - nbAllocationsBefore;
+
+  // From here to the next frame, the moving elements belong to the simulation thread
+  _engine.startSimulation();
 }
 
 void Game::render() const {
@@ -110,7 +137,7 @@ void Game::render() const {
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
   _interface.renderEngine();
-  _interface.renderStaminaBars(_selection);
+  _interface.renderStaminaBars(_staminaBars);
 
   if (!_lockedView)
     _interface.renderRectSelect();
@@ -127,7 +154,7 @@ void Game::setLockedView(bool lockedView) {
   _lockedView = lockedView;
 
   if (_lockedView) {
-    setFocusedCharacter(_focusedCharacter);
+    setFocusedCharacter(getFocusedCharacter());
     _interface.setTextTopLeft(getInfoTextLockedView());
   }
 
@@ -226,11 +253,16 @@ void Game::changeFocusInDirection(glm::vec2 direction) {
   Camera& cam = Camera::getInstance();
   float threshold = sqrt(2)/2.f;
 
-  Controllable* closestMovingElement = _focusedCharacter;
+  Controllable* focusedCharacter = getFocusedCharacter();
+
+  if (!focusedCharacter)
+    return;
+
+  Controllable* closestMovingElement = focusedCharacter;
   float closestDist = MAX_COORD;
 
   for (auto ctrl = _engine.getControllableElements().begin(); ctrl != _engine.getControllableElements().end(); ctrl++) {
-    glm::vec2 toChar = (*ctrl)->getPos() - _focusedCharacter->getPos();
+    glm::vec2 toChar = (*ctrl)->getPos() - focusedCharacter->getPos();
     float distance = glm::length(toChar);
 
     // Character is in the right direction, with +- M_PI/4 margin
@@ -259,12 +291,21 @@ void Game::changeFocusInDirection(glm::vec2 direction) {
 }
 
 void Game::setFocusedCharacter(Controllable* focusedCharacter) {
-  _focusedCharacter = focusedCharacter;
+  _focusedCharacter = focusedCharacter ? focusedCharacter->getHandle() : INVALID_SLOT_HANDLE;
 
   _selection.clear();
-  Lion* focusedLion = dynamic_cast<Lion*>(_focusedCharacter);
-  if (focusedLion)
-    _selection.insert(focusedLion);
+  if (focusedCharacter && focusedCharacter->getKind() == ElementKind::LION)
+    _selection.insert(focusedCharacter->getHandle());
+}
+
+void Game::getSelectedLions(std::vector<Lion*>& lions) const {
+  lions.clear();
+
+  for (auto it = _selection.begin(); it != _selection.end(); it++) {
+    igMovingElement* elmt = _engine.getElement(*it);
+    if (elmt && elmt->getKind() == ElementKind::LION)
+      lions.push_back(static_cast<Lion*>(elmt));
+  }
 }
 
 bool Game::pickCharacter(glm::ivec2 screenTarget) {
@@ -282,11 +323,13 @@ bool Game::pickCharacter(glm::ivec2 screenTarget) {
 }
 
 void Game::moveFocused(glm::ivec2 screenTarget, bool perpetualMotion) {
-  if (_focusedCharacter) {
+  Controllable* focusedCharacter = getFocusedCharacter();
+
+  if (focusedCharacter) {
     if (perpetualMotion)
-      _focusedCharacter->setMovingDirection(_engine.get2DCoord(screenTarget) - _focusedCharacter->getPos());
+      focusedCharacter->setMovingDirection(_engine.get2DCoord(screenTarget) - focusedCharacter->getPos());
     else
-      _focusedCharacter->setTarget(_engine.get2DCoord(screenTarget));
+      focusedCharacter->setTarget(_engine.get2DCoord(screenTarget));
   }
 }
 
@@ -294,12 +337,12 @@ void Game::select(glm::ivec4 rect, bool add) {
   if (!add)
     _selection.clear();
 
-  const std::set<Controllable*> controllableElements = _engine.getControllableElements();
+  const std::unordered_set<Controllable*>& controllableElements = _engine.getControllableElements();
   for (auto it = controllableElements.begin(); it != controllableElements.end(); it++) {
-    Lion *lion = dynamic_cast<Lion*>(*it);
-    if (lion && !lion->isDead()) {
+    if ((*it)->getKind() == ElementKind::LION && !(*it)->isDead()) {
+      Lion *lion = static_cast<Lion*>(*it);
       // controllableElements[i] is not selected yet, we can bother to calculate
-      if (_selection.find(lion) == _selection.end()) {
+      if (_selection.find(lion->getHandle()) == _selection.end()) {
         glm::ivec4 SpriteRect = lion->getScreenRect();
 
         int centerX, centerY;
@@ -308,13 +351,13 @@ void Game::select(glm::ivec4 rect, bool add) {
         centerY = SpriteRect.y + SpriteRect.w / 2;
 
         if (ut::contains(rect, glm::ivec2(centerX, centerY)))
-          _selection.insert(lion);
+          _selection.insert(lion->getHandle());
 
         else if (   ut::contains(SpriteRect, glm::ivec2(rect.x, rect.y)) ||
                     ut::contains(SpriteRect, glm::ivec2(rect.x + rect.z, rect.y)) ||
                     ut::contains(SpriteRect, glm::ivec2(rect.x + rect.z, rect.y + rect.w)) ||
                     ut::contains(SpriteRect, glm::ivec2(rect.x, rect.y + rect.w))  ) {
-          _selection.insert(lion);
+          _selection.insert(lion->getHandle());
         }
       }
     }
@@ -323,12 +366,10 @@ void Game::select(glm::ivec4 rect, bool add) {
 
 void Game::selectAllLions() {
   _selection.clear();
-  const std::set<Controllable*> controllableElements = _engine.getControllableElements();
+  const std::unordered_set<Controllable*>& controllableElements = _engine.getControllableElements();
   for (auto it = controllableElements.begin(); it != controllableElements.end(); it++) {
-    Lion *lion = dynamic_cast<Lion*>(*it);
-    if (lion && !lion->isDead()) {
-      _selection.insert(lion);
-    }
+    if ((*it)->getKind() == ElementKind::LION && !(*it)->isDead())
+      _selection.insert((*it)->getHandle());
   }
 }
 
@@ -353,21 +394,24 @@ void Game::createLion(glm::ivec2 screenTarget) {
 
 void Game::moveSelection(glm::ivec2 screenTarget) {
   glm::vec2 target = _engine.get2DCoord(screenTarget);
+  std::vector<Lion*> selection;
+  getSelectedLions(selection);
 
-  for(auto it = _selection.begin(); it != _selection.end(); ++it) {
-    Controllable* ctrl = dynamic_cast<Controllable*>(*it);
-    if (ctrl) {
-      ctrl->setTarget(target);
-    }
+  for(auto it = selection.begin(); it != selection.end(); ++it) {
+    Controllable* ctrl = *it;
+    ctrl->setTarget(target);
   }
 }
 
 void Game::goBackToSelection() {
-  if (!_selection.empty()) {
+  std::vector<Lion*> selection;
+  getSelectedLions(selection);
+
+  if (!selection.empty()) {
     glm::vec2 barycenter;
     float nbSelected = 0;
 
-    for (auto it = _selection.begin(); it != _selection.end(); ++it) {
+    for (auto it = selection.begin(); it != selection.end(); ++it) {
       barycenter += (*it)->getPos();
       nbSelected++;
     }
@@ -377,13 +421,19 @@ void Game::goBackToSelection() {
 }
 
 void Game::makeLionsRun() {
-  for (auto it = _selection.begin(); it != _selection.end(); ++it) {
+  std::vector<Lion*> selection;
+  getSelectedLions(selection);
+
+  for (auto it = selection.begin(); it != selection.end(); ++it) {
     (*it)->beginRunning();
   }
 }
 
 void Game::stopLionsRun() {
-  for (auto it = _selection.begin(); it != _selection.end(); ++it) {
+  std::vector<Lion*> selection;
+  getSelectedLions(selection);
+
+  for (auto it = selection.begin(); it != selection.end(); ++it) {
     (*it)->beginWalking();
   }
 }
@@ -391,7 +441,10 @@ void Game::stopLionsRun() {
 void Game::switchLionsRun() {
   bool makeThemAllRun = false;
   bool generalStrategyChosen = false;
-  for (auto it = _selection.begin(); it != _selection.end(); ++it) {
+  std::vector<Lion*> selection;
+  getSelectedLions(selection);
+
+  for (auto it = selection.begin(); it != selection.end(); ++it) {
     if (!generalStrategyChosen) {
       generalStrategyChosen = true;
       makeThemAllRun = !(*it)->isRunning();
@@ -406,8 +459,11 @@ void Game::switchLionsRun() {
 }
 
 void Game::killLion() {
-  if (!_selection.empty()) {
-    (*_selection.begin())->die();
+  std::vector<Lion*> selection;
+  getSelectedLions(selection);
+
+  if (!selection.empty()) {
+    selection.front()->die();
     _nbLions--;
   }
 }
@@ -463,18 +519,18 @@ void Game::interruptHunt() {
 
 void Game::startNewHunt() {
   if (!_huntHasStarted) {
-    std::vector<igMovingElement*> toDelete;
+    std::vector<SlotHandle> toDelete;
 
-    const std::set<Controllable*>& lions = _engine.getControllableElements();
+    const std::unordered_set<Controllable*>& lions = _engine.getControllableElements();
     for (auto it = lions.begin(); it != lions.end(); it++) {
-      if (dynamic_cast<Lion*>(*it))
-        toDelete.push_back(*it);
+      if ((*it)->getKind() == ElementKind::LION)
+        toDelete.push_back((*it)->getHandle());
     }
 
-    const std::set<Controllable*>& deadLions = _engine.getDeadControllableElements();
+    const std::unordered_set<Controllable*>& deadLions = _engine.getDeadControllableElements();
     for (auto it = deadLions.begin(); it != deadLions.end(); it++) {
-      if (dynamic_cast<Lion*>(*it))
-        toDelete.push_back(*it);
+      if ((*it)->getKind() == ElementKind::LION)
+        toDelete.push_back((*it)->getHandle());
     }
 
     _engine.deleteElements(toDelete);
@@ -503,13 +559,6 @@ void Game::genTribe(glm::ivec2 screenTarget) {
 }
 
 void Game::deleteTribe() {
-  std::vector<igMovingElement*> tribe(_tribe.size());
-
-  #pragma omp parallel for
-  for (int i = 0; i < _tribe.size(); i++) {
-    tribe[i] = (igMovingElement*) _tribe[i];
-  }
-
-  _engine.deleteElements(tribe);
+  _engine.deleteElements(_tribe);
   _tribe.clear();
 }
@@ -37,15 +37,16 @@ public:
 
   void changeFocusInDirection(glm::vec2 direction);
 
-  inline bool hasFocusedCharacter() const {return _focusedCharacter != nullptr;}
-  inline glm::vec2 getFocusedPos() const {if (!_focusedCharacter) return glm::vec2(0,0);
-    return _focusedCharacter->getPos();}
-  inline float getCharacterHeight() const {if (!_focusedCharacter) return 0;
-    return _focusedCharacter->getSize().y;}
-  inline const igMovingElement* getFocusedCharacter() const { return _focusedCharacter; }
-
-  inline void setTarget(glm::vec2 target) {if (_focusedCharacter) _focusedCharacter->setTarget(target);}
-  inline void stopMoving() {if (_focusedCharacter) _focusedCharacter->stop();}
+  inline bool hasFocusedCharacter() const {return getFocusedCharacter() != nullptr;}
+  inline glm::vec2 getFocusedPos() const {if (!hasFocusedCharacter()) return glm::vec2(0,0);
+    return getFocusedCharacter()->getPos();}
+  inline float getCharacterHeight() const {if (!hasFocusedCharacter()) return 0;
+    return getFocusedCharacter()->getSize().y;}
+  // nullptr if there is none or if it has been deleted
+  inline Controllable* getFocusedCharacter() const {return _engine.getControllable(_focusedCharacter);}
+
+  inline void setTarget(glm::vec2 target) {if (hasFocusedCharacter()) getFocusedCharacter()->setTarget(target);}
+  inline void stopMoving() {if (hasFocusedCharacter()) getFocusedCharacter()->stop();}
   void moveFocused(glm::ivec2 screenTarget, bool perpetualMotion = false);
 
   inline void setPovCamera(bool povCamera) {_povCamera = povCamera; _interface.setTextTopLeft(getInfoTextLockedView());}
@@ -69,6 +70,12 @@ public:
   void deleteTribe();
 
   inline void switchWireframe() {_engine.switchWireframe();}
+  inline void switchOcclusionCulling() {_engine.switchOcclusionCulling();}
+  inline void switchPrefetching() {_engine.switchPrefetching();}
+  inline void switchSpriteRendering() {_engine.switchSpriteRendering();}
+  inline void switchFrontToBack() {_engine.switchFrontToBack();}
+  inline void switchOverdrawView() {_engine.switchOverdrawView();}
+  inline void prefetchAround(glm::vec2 pos) {_engine.prefetchAround(pos);}
   inline void setScrollSpeedToSlow(bool scrollSpeedSlow) {_scrollSpeedSlow = scrollSpeedSlow;}
   inline bool getScrollSpeedSlow() const {return _scrollSpeedSlow;}
   inline bool huntHasStarted() const {return _huntHasStarted;}
@@ -84,9 +91,12 @@ protected:
   std::string getInfoTextGlobalView() const;
   std::string getHuntText() const;
   void setFocusedCharacter(Controllable* focusedCharacter);
+  // Fills lions with the selected lions that have not been deleted
+  void getSelectedLions(std::vector<Lion*>& lions) const;
 
-  Controllable* _focusedCharacter;
-  std::vector<Controllable*> _tribe;
+  // Handles rather than pointers, the elements can be deleted by the engine
+  SlotHandle _focusedCharacter;
+  std::vector<SlotHandle> _tribe;
 
   bool _lockedView;
   bool _displayLog;
@@ -94,6 +104,9 @@ protected:
   Engine& _engine;
   igLayout _interface;
   PopupMenu _popupMenu;
+  // Rendered while the simulation thread runs, so they do not read the lions
+  std::vector<StaminaBar> _staminaBars;
+  std::vector<Lion*> _selectedLions;
 
   // Locked view
 
@@ -112,5 +125,7 @@ protected:
 
   Clock _huntStart;
 
-  std::set<Lion*> _selection;
+  size_t _nbUpdateAllocations; // Counted on the main thread, logged by the next update
+
+  std::set<SlotHandle> _selection;
 };
@@ -0,0 +1,58 @@
+#include "simulationThread.h"
+
+#include "clock.h"
+
+SimulationThread::SimulationThread() :
+  _continue(true),
+  _jobPending(false),
+  _msLastJob(0),
+  _thread(&SimulationThread::executeJobs, this) {}
+
+void SimulationThread::executeJobs() {
+  std::unique_lock<std::mutex> lock(_mutex);
+
+  while (true) {
+    while (!_jobPending) {
+      if (!_continue)
+        return;
+      _cvJobAdded.wait(lock);
+    }
+
+    lock.unlock();
+
+    Clock jobClock(ClockType::INDEPENDENT);
+    _job();
+    int msJob = jobClock.getElapsedTime();
+
+    lock.lock();
+    _msLastJob = msJob;
+    _jobPending = false;
+    _cvJobDone.notify_all();
+  }
+}
+
+void SimulationThread::start(std::function<void()> job) {
+  std::unique_lock<std::mutex> lock(_mutex);
+  _job = job;
+  _jobPending = true;
+  _cvJobAdded.notify_one();
+}
+
+void SimulationThread::wait() {
+  std::unique_lock<std::mutex> lock(_mutex);
+  while (_jobPending) {
+    _cvJobDone.wait(lock);
+  }
+}
+
+void SimulationThread::join() {
+  {
+    // Under the lock so that the wake up cannot be missed, the pending job is still executed
+    std::unique_lock<std::mutex> lock(_mutex);
+    _continue = false;
+  }
+  _cvJobAdded.notify_one();
+
+  if (_thread.joinable())
+    _thread.join();
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+/** Runs a job of the main thread on a separate thread, one at a time.
+  * The Engine gives it the simulation ticks of a frame, which run while the
+  * main thread renders the frame and swaps the buffers. The simulated state is
+  * not locked: it belongs to the worker from start to wait, and to the main
+  * thread the rest of the time.
+  */
+class SimulationThread {
+public:
+  SimulationThread();
+
+  // The previous job must have been waited for
+  void start(std::function<void()> job);
+  // Returns once the job has been executed, immediately if there is none
+  void wait();
+  void join();
+
+  // Duration of the last job, measured on the worker
+  inline int getMsLastJob() const {return _msLastJob;}
+
+private:
+  void executeJobs();
+
+  bool _continue;
+  bool _jobPending;
+  std::function<void()> _job;
+  int _msLastJob;
+
+  std::mutex _mutex;
+  std::condition_variable _cvJobAdded;
+  std::condition_variable _cvJobDone;
+
+  std::thread _thread;
+};
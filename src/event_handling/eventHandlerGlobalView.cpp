@@ -70,6 +70,26 @@ void EventHandlerGlobalView::handleKeyPressed(const SDL_Event& event) {
     case SDL_SCANCODE_Z:
       _game.switchWireframe();
       break;
+
+    case SDL_SCANCODE_O:
+      _game.switchOcclusionCulling();
+      break;
+
+    case SDL_SCANCODE_I:
+      _game.switchPrefetching();
+      break;
+
+    case SDL_SCANCODE_M:
+      _game.switchSpriteRendering();
+      break;
+
+    case SDL_SCANCODE_N:
+      _game.switchFrontToBack();
+      break;
+
+    case SDL_SCANCODE_V:
+      _game.switchOverdrawView();
+      break;
   }
 }
 
@@ -81,6 +101,17 @@ bool EventHandlerGlobalView::handleEvent(const SDL_Event& event) {
       cam.zoom(- _scrollSpeed * event.wheel.y);
       break;
 
+    case SDL_MOUSEMOTION: {
+      // The hovered position of the minimap is where the camera will likely be moved
+      glm::vec2 minimapCoord = _game.getInterface().getMinimapClickCoords(glm::ivec2(event.motion.x, event.motion.y));
+
+      if (minimapCoord.x >= 0 && minimapCoord.x <= 1 && minimapCoord.y >= 0 && minimapCoord.y <= 1) {
+        minimapCoord.y = 1 - minimapCoord.y;
+        _game.prefetchAround(MAX_COORD * minimapCoord);
+      }
+    }
+      break;
+
     case SDL_MOUSEBUTTONDOWN: {
       const Uint8 *keyboardState = SDL_GetKeyboardState(NULL);
 
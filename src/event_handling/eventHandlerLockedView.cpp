@@ -145,7 +145,7 @@ bool EventHandlerLockedView::handleEvent(const SDL_Event& event) {
       }
 
       else {
-        if (dynamic_cast<const Lion*>(_game.getFocusedCharacter()))
+        if (_game.hasFocusedCharacter() && _game.getFocusedCharacter()->getKind() == ElementKind::LION)
           _game.moveFocused(windowCoords, true);
         else
           _game.moveFocused(windowCoords, false);
@@ -0,0 +1,221 @@
+#include "boidsKernel.h"
+
+#include <cmath>
+#include <stdint.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#include <emmintrin.h>
+	#define BOIDS_SSE
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+	#include <arm_neon.h>
+	#define BOIDS_NEON
+#endif
+
+namespace {
+	struct Accumulator {
+		float sumDirX = 0.f, sumDirY = 0.f;
+		float sumAttractX = 0.f, sumAttractY = 0.f;
+		int nbDir = 0;
+		int nbAttract = 0;
+		float minRepDist2;
+		int closestRep = -1;
+	};
+
+	// Same zones as the vector loops, for the neighbours from begin to the end
+	void accumulateScalar(glm::vec2 pos, const BoidsNeighbours& neighbours, size_t begin,
+	                      float repulsion2, float orientation2, float attraction2, Accumulator& acc) {
+		for (size_t i = begin; i < neighbours.size(); i++) {
+			float dx = neighbours.x[i] - pos.x;
+			float dy = neighbours.y[i] - pos.y;
+			float dist2 = dx*dx + dy*dy;
+
+			if (dist2 < repulsion2) {
+				if (dist2 < acc.minRepDist2) {
+					acc.minRepDist2 = dist2;
+					acc.closestRep = i;
+				}
+			}
+
+			else if (dist2 < orientation2) {
+				acc.sumDirX += neighbours.dirX[i];
+				acc.sumDirY += neighbours.dirY[i];
+				acc.nbDir++;
+			}
+
+			else if (dist2 < attraction2) {
+				acc.sumAttractX += neighbours.x[i];
+				acc.sumAttractY += neighbours.y[i];
+				acc.nbAttract++;
+			}
+		}
+	}
+
+	// Adds the results of the 4 lanes of the vector loop
+	void mergeLanes(const float* sumDirX, const float* sumDirY, const float* sumAttractX, const float* sumAttractY,
+	                const int32_t* nbDir, const int32_t* nbAttract, const float* minRepDist2, const int32_t* closestRep,
+	                Accumulator& acc) {
+		for (int l = 0; l < 4; l++) {
+			acc.sumDirX     += sumDirX[l];
+			acc.sumDirY     += sumDirY[l];
+			acc.sumAttractX += sumAttractX[l];
+			acc.sumAttractY += sumAttractY[l];
+			acc.nbDir       += nbDir[l];
+			acc.nbAttract   += nbAttract[l];
+
+			// On a tie the first neighbour is kept, as in the scalar loop
+			if (closestRep[l] >= 0 && (minRepDist2[l] < acc.minRepDist2 ||
+			    (minRepDist2[l] == acc.minRepDist2 && closestRep[l] < acc.closestRep))) {
+				acc.minRepDist2 = minRepDist2[l];
+				acc.closestRep = closestRep[l];
+			}
+		}
+	}
+}
+
+void computeBoidsInfo(glm::vec2 pos, const BoidsNeighbours& neighbours,
+                      float repulsionRadius, float orientationRadius, float attractionRadius,
+                      BoidsInfo& info) {
+	float repulsion2   = repulsionRadius   * repulsionRadius;
+	float orientation2 = orientationRadius * orientationRadius;
+	float attraction2  = attractionRadius  * attractionRadius;
+
+	Accumulator acc;
+	acc.minRepDist2 = repulsion2;
+
+	size_t nbVectorized = 0;
+
+#if defined(BOIDS_SSE) || defined(BOIDS_NEON)
+	nbVectorized = neighbours.size() / 4 * 4;
+
+	alignas(16) float sumDirXLanes[4], sumDirYLanes[4], sumAttractXLanes[4], sumAttractYLanes[4];
+	alignas(16) float minRepDist2Lanes[4];
+	alignas(16) int32_t nbDirLanes[4], nbAttractLanes[4], closestRepLanes[4];
+#endif
+
+#if defined(BOIDS_SSE)
+	__m128 posX = _mm_set1_ps(pos.x), posY = _mm_set1_ps(pos.y);
+	__m128 rep2 = _mm_set1_ps(repulsion2);
+	__m128 ori2 = _mm_set1_ps(orientation2);
+	__m128 att2 = _mm_set1_ps(attraction2);
+
+	__m128 sumDirX = _mm_setzero_ps(), sumDirY = _mm_setzero_ps();
+	__m128 sumAttractX = _mm_setzero_ps(), sumAttractY = _mm_setzero_ps();
+	__m128i nbDir = _mm_setzero_si128(), nbAttract = _mm_setzero_si128();
+	__m128 minRepDist2 = rep2;
+	__m128i closestRep = _mm_set1_epi32(-1);
+	__m128i index = _mm_set_epi32(3, 2, 1, 0);
+	__m128i four = _mm_set1_epi32(4);
+
+	for (size_t i = 0; i < nbVectorized; i += 4) {
+		__m128 x = _mm_loadu_ps(&neighbours.x[i]);
+		__m128 y = _mm_loadu_ps(&neighbours.y[i]);
+		__m128 dx = _mm_sub_ps(x, posX);
+		__m128 dy = _mm_sub_ps(y, posY);
+		__m128 dist2 = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+
+		__m128 inRep = _mm_cmplt_ps(dist2, rep2);
+		__m128 inOri = _mm_andnot_ps(inRep, _mm_cmplt_ps(dist2, ori2));
+		__m128 inAtt = _mm_andnot_ps(_mm_cmplt_ps(dist2, ori2), _mm_cmplt_ps(dist2, att2));
+
+		sumDirX = _mm_add_ps(sumDirX, _mm_and_ps(inOri, _mm_loadu_ps(&neighbours.dirX[i])));
+		sumDirY = _mm_add_ps(sumDirY, _mm_and_ps(inOri, _mm_loadu_ps(&neighbours.dirY[i])));
+		sumAttractX = _mm_add_ps(sumAttractX, _mm_and_ps(inAtt, x));
+		sumAttractY = _mm_add_ps(sumAttractY, _mm_and_ps(inAtt, y));
+
+		// A true mask is -1
+		nbDir     = _mm_sub_epi32(nbDir,     _mm_castps_si128(inOri));
+		nbAttract = _mm_sub_epi32(nbAttract, _mm_castps_si128(inAtt));
+
+		// Only the distances in the repulsion zone can be below minRepDist2
+		__m128 closer = _mm_cmplt_ps(dist2, minRepDist2);
+		__m128i closerInt = _mm_castps_si128(closer);
+		minRepDist2 = _mm_or_ps(_mm_and_ps(closer, dist2), _mm_andnot_ps(closer, minRepDist2));
+		closestRep = _mm_or_si128(_mm_and_si128(closerInt, index), _mm_andnot_si128(closerInt, closestRep));
+
+		index = _mm_add_epi32(index, four);
+	}
+
+	_mm_store_ps(sumDirXLanes, sumDirX);
+	_mm_store_ps(sumDirYLanes, sumDirY);
+	_mm_store_ps(sumAttractXLanes, sumAttractX);
+	_mm_store_ps(sumAttractYLanes, sumAttractY);
+	_mm_store_ps(minRepDist2Lanes, minRepDist2);
+	_mm_store_si128((__m128i*) nbDirLanes, nbDir);
+	_mm_store_si128((__m128i*) nbAttractLanes, nbAttract);
+	_mm_store_si128((__m128i*) closestRepLanes, closestRep);
+
+#elif defined(BOIDS_NEON)
+	float32x4_t posX = vdupq_n_f32(pos.x), posY = vdupq_n_f32(pos.y);
+	float32x4_t rep2 = vdupq_n_f32(repulsion2);
+	float32x4_t ori2 = vdupq_n_f32(orientation2);
+	float32x4_t att2 = vdupq_n_f32(attraction2);
+	float32x4_t zero = vdupq_n_f32(0.f);
+
+	float32x4_t sumDirX = zero, sumDirY = zero;
+	float32x4_t sumAttractX = zero, sumAttractY = zero;
+	uint32x4_t nbDir = vdupq_n_u32(0), nbAttract = vdupq_n_u32(0);
+	float32x4_t minRepDist2 = rep2;
+	int32x4_t closestRep = vdupq_n_s32(-1);
+	const int32_t firstIndices[4] = {0, 1, 2, 3};
+	int32x4_t index = vld1q_s32(firstIndices);
+	int32x4_t four = vdupq_n_s32(4);
+
+	for (size_t i = 0; i < nbVectorized; i += 4) {
+		float32x4_t x = vld1q_f32(&neighbours.x[i]);
+		float32x4_t y = vld1q_f32(&neighbours.y[i]);
+		float32x4_t dx = vsubq_f32(x, posX);
+		float32x4_t dy = vsubq_f32(y, posY);
+		float32x4_t dist2 = vmlaq_f32(vmulq_f32(dx, dx), dy, dy);
+
+		uint32x4_t inRep = vcltq_f32(dist2, rep2);
+		uint32x4_t inOri = vbicq_u32(vcltq_f32(dist2, ori2), inRep);
+		uint32x4_t inAtt = vbicq_u32(vcltq_f32(dist2, att2), vcltq_f32(dist2, ori2));
+
+		sumDirX = vaddq_f32(sumDirX, vbslq_f32(inOri, vld1q_f32(&neighbours.dirX[i]), zero));
+		sumDirY = vaddq_f32(sumDirY, vbslq_f32(inOri, vld1q_f32(&neighbours.dirY[i]), zero));
+		sumAttractX = vaddq_f32(sumAttractX, vbslq_f32(inAtt, x, zero));
+		sumAttractY = vaddq_f32(sumAttractY, vbslq_f32(inAtt, y, zero));
+
+		// A true mask is 0xFFFFFFFF, -1 in two's complement
+		nbDir     = vsubq_u32(nbDir,     inOri);
+		nbAttract = vsubq_u32(nbAttract, inAtt);
+
+		// Only the distances in the repulsion zone can be below minRepDist2
+		uint32x4_t closer = vcltq_f32(dist2, minRepDist2);
+		minRepDist2 = vbslq_f32(closer, dist2, minRepDist2);
+		closestRep = vbslq_s32(closer, index, closestRep);
+
+		index = vaddq_s32(index, four);
+	}
+
+	vst1q_f32(sumDirXLanes, sumDirX);
+	vst1q_f32(sumDirYLanes, sumDirY);
+	vst1q_f32(sumAttractXLanes, sumAttractX);
+	vst1q_f32(sumAttractYLanes, sumAttractY);
+	vst1q_f32(minRepDist2Lanes, minRepDist2);
+	vst1q_s32(nbDirLanes, vreinterpretq_s32_u32(nbDir));
+	vst1q_s32(nbAttractLanes, vreinterpretq_s32_u32(nbAttract));
+	vst1q_s32(closestRepLanes, closestRep);
+#endif
+
+#if defined(BOIDS_SSE) || defined(BOIDS_NEON)
+	mergeLanes(sumDirXLanes, sumDirYLanes, sumAttractXLanes, sumAttractYLanes,
+	           nbDirLanes, nbAttractLanes, minRepDist2Lanes, closestRepLanes, acc);
+#endif
+
+	// The neighbours left over by the vector loop, or all of them without SIMD
+	accumulateScalar(pos, neighbours, nbVectorized, repulsion2, orientation2, attraction2, acc);
+
+	info.sumOfDirs = glm::vec2(acc.sumDirX, acc.sumDirY);
+	info.nbDir = acc.nbDir;
+	info.sumPosAttract = glm::vec2(acc.sumAttractX, acc.sumAttractY);
+	info.nbAttract = acc.nbAttract;
+
+	if (acc.closestRep >= 0) {
+		info.closestRep = glm::vec2(neighbours.x[acc.closestRep], neighbours.y[acc.closestRep]);
+		info.minRepDst = sqrt(acc.minRepDist2);
+	}
+
+	else
+		info.minRepDst = repulsionRadius;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <stddef.h> // size_t
+#include <vector>
+
+// What an animal of a herd sees of the others
+struct BoidsInfo {
+	// Only meaningful when the matching min distance is below its radius
+	glm::vec2 closestRep = glm::vec2(0.f);
+	glm::vec2 closestFlee = glm::vec2(0.f);
+	glm::vec2 sumPosAttract = glm::vec2(0.f);
+	glm::vec2 sumPosFlee = glm::vec2(0.f);
+	glm::vec2 sumOfDirs = glm::vec2(0.f);
+	int nbDir = 0;
+	int nbAttract = 0;
+	int nbFlee = 0;
+	float minRepDst, minFleeDst;
+};
+
+// Neighbours of an animal in SoA layout, to be processed several at a time
+struct BoidsNeighbours {
+	std::vector<float> x, y;
+	std::vector<float> dirX, dirY;
+
+	inline size_t size() const {return x.size();}
+	inline void clear() {x.clear(); y.clear(); dirX.clear(); dirY.clear();}
+	inline void push(glm::vec2 pos, glm::vec2 dir) {
+		x.push_back(pos.x); y.push_back(pos.y); dirX.push_back(dir.x); dirY.push_back(dir.y);
+	}
+};
+
+/** Sorts the neighbours of the animal at pos into the repulsion, orientation and
+  * attraction zones of the boids model (repulsion < orientation < attraction).
+  * Fills the fields of info related to them, the flee fields are left untouched.
+  * Uses SSE2 or NEON when available, compares squared distances and accumulates
+  * with masks, so the only square root is the one of the closest repulsion distance.
+  */
+void computeBoidsInfo(glm::vec2 pos, const BoidsNeighbours& neighbours,
+                      float repulsionRadius, float orientationRadius, float attractionRadius,
+                      BoidsInfo& info);
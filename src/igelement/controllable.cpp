@@ -2,8 +2,9 @@
 
 #include "camera.h"
 
-Controllable::Controllable(glm::vec2 position, AnimationManager graphics, const TerrainGeometry& terrainGeometry) :
- 	igMovingElement(position, graphics, terrainGeometry),
+Controllable::Controllable(glm::vec2 position, AnimationManager graphics, const TerrainGeometry& terrainGeometry,
+	ElementKind kind, FactionMask factions) :
+ 	igMovingElement(position, graphics, terrainGeometry, kind, factions),
   _target(position),
   _alwaysInSameDirection(false),
   _projectedVertices({}) {}
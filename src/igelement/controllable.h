@@ -5,7 +5,8 @@
 
 class Controllable : public igMovingElement {
 public:
-	Controllable(glm::vec2 position, AnimationManager _graphics, const TerrainGeometry& terrainGeometry);
+	Controllable(glm::vec2 position, AnimationManager _graphics, const TerrainGeometry& terrainGeometry,
+	             ElementKind kind = ElementKind::CONTROLLABLE, FactionMask factions = FACTION_HUMAN);
 
 	virtual void update(int msElapsed);
 	virtual void setTarget(glm::vec2 t, ANM_TYPE anim = ANM_TYPE::WALK);
@@ -0,0 +1,14 @@
+#include "forestImpostor.h"
+
+ForestImpostor::ForestImpostor(glm::vec2 position, float height, glm::vec2 size,
+	const TextureArray* texArray, size_t layer, glm::vec4 texRectangle) :
+	igElement(position, 0.f, ElementKind::FOREST_IMPOSTOR, FACTION_FLORA),
+	_texArray(texArray) {
+
+	_size = size;
+
+	setVertices();
+	setHeight(height);
+	setTexCoord(texRectangle);
+	setLayer(layer);
+}
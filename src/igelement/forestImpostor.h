@@ -0,0 +1,15 @@
+#pragma once
+#include "igElement.h"
+
+// Card standing for the trees of a part of a chunk, textured with a picture of them baked at runtime
+class ForestImpostor : public igElement {
+public:
+	// texRectangle is the part of the layer containing the picture, as in TextureArray::getTexRectangle
+	ForestImpostor(glm::vec2 position, float height, glm::vec2 size,
+	               const TextureArray* texArray, size_t layer, glm::vec4 texRectangle);
+
+	inline const TextureArray* getTexArray() const {return _texArray;}
+
+protected:
+	const TextureArray* _texArray;
+};
@@ -0,0 +1,872 @@
+#include "herdStore.h"
+
+#include <climits>
+#include <cmath>
+
+#include "utils.h"
+
+#define HERD_PANIC_FLEE_RADIUS 20.f
+#define HERD_REPULSION_RADIUS 8.f // r < o < a
+#define HERD_ORIENTATION_RADIUS 15.f
+#define HERD_ATTRACTION_RADIUS 50.f
+// The neighbour lists hold the animals closer than the attraction radius plus this margin, they stay valid
+// until an animal has moved by half of it. With the attraction radius, it must not exceed the grid cells
+#define HERD_NEIGHBOURS_SKIN 10.f
+
+#define HERD_SPEED_WALKING 7.f
+#define HERD_SPEED_RUNNING 15.f
+
+#define HERD_MS_AVERAGE_RECOVERING 3000
+#define HERD_MS_AVERAGE_EATING 7000
+#define HERD_MS_AVERAGE_FINDING_FOOD 2000
+#define HERD_MS_AVERAGE_BEFORE_CHANGING_DIR 500
+#define HERD_MS_WAKE_TIMERS_TICK 16
+
+#define HERD_GRID_SIZE ((int) std::ceil(MAX_COORD / HERD_LINE_OF_SIGHT))
+
+// A herd expands when its disk plus the first margin touches an active chunk, and collapses when its bounding
+// box plus the second one does not. The gap between them keeps a herd from flickering on a chunk border
+#define HERD_LOD_EXPAND_MARGIN 50.f
+#define HERD_LOD_COLLAPSE_MARGIN 150.f
+// An idle animal walks about a fifth of the time, the aggregate moves at the resulting mean speed
+#define HERD_AGGREGATE_SPEED 1.5f
+#define HERD_AGGREGATE_MS_BEFORE_HEADING_CHANGE 20000
+#define HERD_AGGREGATE_MIN_SPREAD 5.f
+#define HERD_GOLDEN_ANGLE 2.39996323f
+
+// The simulation of the herds draws from its own generator, a run is the same whatever the other threads do
+#define HERD_RANDOM_SEED 1
+
+namespace {
+	// Deterministic number in [0,1) from two integers, replaces RANDOMF where a herd must come back the same way
+	float hashToUnit(uint32_t a, uint32_t b) {
+		uint32_t h = a * 0x9E3779B1u ^ (b + 0x7F4A7C15u) * 0x85EBCA77u;
+		h ^= h >> 15;
+		h *= 0x2C1B3C6Du;
+		h ^= h >> 12;
+		return (h & 0xFFFFFF) / 16777216.f;
+	}
+}
+
+HerdStore::HerdStore(const TerrainGeometry& terrainGeometry) :
+	_terrainGeometry(terrainGeometry),
+	_nbAlive(0),
+	_nbCollapsedGroups(0),
+	_nbCollapsedAnimals(0),
+	_simulatedHerdsChanged(false),
+	_msNow(0),
+	_random(HERD_RANDOM_SEED),
+	_wakeTimers(HERD_MS_WAKE_TIMERS_TICK),
+	_nbEvaluated(0),
+	_gridSize(HERD_GRID_SIZE),
+	_nbNeighbourListsBuilds(0) {}
+
+size_t HerdStore::registerSpecies(const AnimationManagerInitializer& init) {
+	for (size_t i = 0; i < _species.size(); i++) {
+		if (_species[i].init == &init)
+			return i;
+	}
+
+	HerdSpecies species;
+	species.init = &init;
+
+	const std::map<ANM_TYPE, AnimInfo>& animInfo = init.getAnimInfo();
+	AnimInfo waitInfo = animInfo.at(ANM_TYPE::WAIT);
+
+	for (int i = 0; i < ANM_TYPE_NB; i++) {
+		auto it = animInfo.find((ANM_TYPE) i);
+		species.animInfo[i] = it != animInfo.end() ? it->second : waitInfo;
+	}
+
+	// Same sizes as the ones of an igMovingElement, the height of the waiting sprite is the size of the species
+	float waitHeight = species.animInfo[(int) ANM_TYPE::WAIT].spriteAbsoluteSize.y;
+
+	for (int i = 0; i < ANM_TYPE_NB; i++) {
+		species.sizes[i] = species.animInfo[i].spriteAbsoluteSize / waitHeight * init.getParameters().size;
+	}
+
+	for (int i = 0; i < ANM_TYPE_NB; i++) {
+		species.offsets[i] = (species.sizes[(int) ANM_TYPE::WAIT].y - species.sizes[i].y) / 2.f;
+	}
+
+	_species.push_back(species);
+	return _species.size() - 1;
+}
+
+void HerdStore::addHerd(const std::vector<glm::vec2>& positions, const AnimationManagerInitializer& species) {
+	if (positions.empty())
+		return;
+
+	HerdGroup group;
+	group.first = _positions.size();
+	group.count = positions.size();
+	group.nbAlive = positions.size();
+	group.collapsed = false;
+	group.centroid = glm::vec2(0.f);
+	group.spread = 0.f;
+	group.heading = 0.f;
+	group.msBeforeHeadingChange = HERD_AGGREGATE_MS_BEFORE_HEADING_CHANGE;
+	group.nbHeadingChanges = 0;
+
+	size_t speciesIndex = registerSpecies(species);
+
+	for (size_t i = 0; i < positions.size(); i++) {
+		addAnimal(positions[i], speciesIndex, _groups.size());
+	}
+
+	_groups.push_back(group);
+}
+
+void HerdStore::addAnimal(glm::vec2 pos, size_t species, uint32_t group) {
+	_positions.push_back(pos);
+	_previousPositions.push_back(pos);
+	_directions.push_back(glm::vec2(0.f));
+	_speeds.push_back(0.f);
+	_headings.push_back(randomUnit() * 360.f);
+
+	_dead.push_back(false);
+	_moving.push_back(false);
+	_statuses.push_back(AntilopeStatus::IDLE);
+	_boidStatuses.push_back(BoidStatus::ORIENTATION);
+	_linesOfSight.push_back(HERD_LINE_OF_SIGHT * 0.8f);
+	_msPhaseEnds.push_back(_msNow + generateTimePhase(HERD_MS_AVERAGE_EATING));
+	_msDirChangesAllowed.push_back(_msNow);
+	_timesChangedDir.push_back(0);
+	_asleep.push_back(false);
+	_msWakeTimes.push_back(_msNow);
+
+	_speciesIndices.push_back(species);
+	_anims.push_back(ANM_TYPE::WAIT);
+	_sprites.push_back(0);
+	_msInAnim.push_back(0);
+
+	_groupIndices.push_back(group);
+	_nbAlive++;
+}
+
+void HerdStore::kill(HerdHandle animal) {
+	size_t i = animal.index;
+
+	if (_dead[i])
+		return;
+
+	launchAnimation(i, ANM_TYPE::DIE);
+	_speeds[i] = 0.f;
+	_dead[i] = true;
+	_nbAlive--;
+	_groups[_groupIndices[i]].nbAlive--;
+}
+
+HerdHandle HerdStore::findClosest(glm::vec2 pos, float range) const {
+	HerdHandle closest = INVALID_HERD_HANDLE;
+
+	if (_gridStarts.empty())
+		return closest;
+
+	float nearestDist = range;
+
+	// The animals may have left their cell by half the skin since the grid was built
+	float cellsRange = range + HERD_NEIGHBOURS_SKIN / 2.f;
+	int minX = std::max(0, (int) ((pos.x - cellsRange) / HERD_LINE_OF_SIGHT));
+	int minY = std::max(0, (int) ((pos.y - cellsRange) / HERD_LINE_OF_SIGHT));
+	int maxX = std::min(_gridSize-1, (int) ((pos.x + cellsRange) / HERD_LINE_OF_SIGHT));
+	int maxY = std::min(_gridSize-1, (int) ((pos.y + cellsRange) / HERD_LINE_OF_SIGHT));
+
+	for (int x = minX; x <= maxX; x++) {
+	for (int y = minY; y <= maxY; y++) {
+		size_t cell = x * _gridSize + y;
+
+		for (uint32_t k = _gridStarts[cell]; k < _gridStarts[cell+1]; k++) {
+			uint32_t j = _gridAnimals[k];
+			float distance = glm::length(pos - _positions[j]);
+
+			if (!_dead[j] && distance < nearestDist) {
+				nearestDist = distance;
+				closest = HerdHandle{j};
+			}
+		}
+	}
+	}
+
+	return closest;
+}
+
+bool HerdStore::hasAliveAnimalWithin(glm::vec2 pos, float range) const {
+	for (size_t g = 0; g < _groups.size(); g++) {
+		const HerdGroup& group = _groups[g];
+
+		if (group.nbAlive == 0)
+			continue;
+
+		if (group.collapsed) {
+			float radius = std::max(group.spread, HERD_AGGREGATE_MIN_SPREAD) * sqrt(2.f);
+
+			if (glm::length(group.centroid - pos) < range + radius)
+				return true;
+		}
+
+		else {
+			for (size_t i = group.first; i < group.first + group.count; i++) {
+				if (!_dead[i] && glm::length(_positions[i] - pos) < range)
+					return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+bool HerdStore::touchesActiveChunks(glm::vec2 min, glm::vec2 max, const std::vector<bool>& activeChunks) const {
+	glm::uvec2 minChunk = ut::convertToChunkCoords(min);
+	glm::uvec2 maxChunk = ut::convertToChunkCoords(max);
+
+	for (size_t x = minChunk.x; x <= maxChunk.x; x++) {
+	for (size_t y = minChunk.y; y <= maxChunk.y; y++) {
+		if (activeChunks[x * NB_CHUNKS + y])
+			return true;
+	}
+	}
+
+	return false;
+}
+
+void HerdStore::updateSimulationLod(const std::vector<bool>& activeChunks, int msElapsed) {
+	for (size_t g = 0; g < _groups.size(); g++) {
+		HerdGroup& group = _groups[g];
+
+		if (group.collapsed) {
+			advanceAggregate(g, msElapsed);
+
+			float radius = std::max(group.spread, HERD_AGGREGATE_MIN_SPREAD) * sqrt(2.f) + HERD_LOD_EXPAND_MARGIN;
+
+			if (touchesActiveChunks(group.centroid - radius, group.centroid + radius, activeChunks))
+				expand(g);
+		}
+
+		else {
+			glm::vec2 min(MAX_COORD), max(0.f);
+
+			for (size_t i = group.first; i < group.first + group.count; i++) {
+				min = glm::min(min, _positions[i]);
+				max = glm::max(max, _positions[i]);
+			}
+
+			if (!touchesActiveChunks(min - HERD_LOD_COLLAPSE_MARGIN, max + HERD_LOD_COLLAPSE_MARGIN, activeChunks))
+				collapse(g);
+		}
+	}
+}
+
+void HerdStore::collapse(size_t g) {
+	HerdGroup& group = _groups[g];
+	glm::vec2 sumPos(0.f), sumDirs(0.f);
+	size_t firstAlive = group.first;
+
+	for (size_t i = group.first + group.count; i-- > group.first;) {
+		if (!_dead[i]) {
+			sumPos += _positions[i];
+			sumDirs += _directions[i];
+			firstAlive = i;
+		}
+	}
+
+	if (group.nbAlive != 0) {
+		group.centroid = sumPos / (float) group.nbAlive;
+
+		float sumDist2 = 0.f;
+
+		for (size_t i = group.first; i < group.first + group.count; i++) {
+			if (!_dead[i])
+				sumDist2 += glm::dot(_positions[i] - group.centroid, _positions[i] - group.centroid);
+		}
+
+		group.spread = sqrt(sumDist2 / group.nbAlive);
+
+		if (sumDirs.x != 0.f || sumDirs.y != 0.f)
+			group.heading = atan2(sumDirs.y, sumDirs.x) / RAD;
+		else
+			group.heading = _headings[firstAlive];
+	}
+
+	// Only corpses, they stay where they are
+	else {
+		group.centroid = _positions[group.first];
+		group.spread = 0.f;
+	}
+
+	group.collapsed = true;
+	_simulatedHerdsChanged = true;
+	_nbCollapsedGroups++;
+	_nbCollapsedAnimals += group.count;
+}
+
+void HerdStore::expand(size_t g) {
+	HerdGroup& group = _groups[g];
+
+	// Sunflower layout: a uniform disk whose root mean square radius is the spread
+	float radius = std::max(group.spread, HERD_AGGREGATE_MIN_SPREAD) * sqrt(2.f);
+	uint32_t k = 0;
+
+	for (size_t i = group.first; i < group.first + group.count; i++) {
+		if (_dead[i])
+			continue;
+
+		float r = radius * sqrt((k + 0.5f) / group.nbAlive);
+		float theta = k * HERD_GOLDEN_ANGLE + group.heading * RAD;
+		glm::vec2 pos = group.centroid + r * glm::vec2(cos(theta), sin(theta));
+
+		// The aggregate never stops on water, its centroid is a safe fallback
+		_positions[i] = _terrainGeometry.isWater(pos, 0) ? group.centroid : pos;
+		_previousPositions[i] = _positions[i];
+		_directions[i] = glm::vec2(0.f);
+		_speeds[i] = 0.f;
+		_headings[i] = group.heading;
+
+		_moving[i] = false;
+		_statuses[i] = AntilopeStatus::IDLE;
+		_boidStatuses[i] = BoidStatus::ORIENTATION;
+		_linesOfSight[i] = HERD_LINE_OF_SIGHT * 0.8f;
+		_msPhaseEnds[i] = _msNow + HERD_MS_AVERAGE_EATING * (0.6f + 0.8f * hashToUnit(g, k));
+		_msDirChangesAllowed[i] = _msNow;
+		_timesChangedDir[i] = 0;
+		_asleep[i] = false;
+
+		_anims[i] = ANM_TYPE::WAIT;
+		_sprites[i] = 0;
+		_msInAnim[i] = 0;
+		k++;
+	}
+
+	group.collapsed = false;
+	_simulatedHerdsChanged = true;
+	_nbCollapsedGroups--;
+	_nbCollapsedAnimals -= group.count;
+}
+
+void HerdStore::advanceAggregate(size_t g, int msElapsed) {
+	HerdGroup& group = _groups[g];
+
+	if (group.nbAlive == 0)
+		return;
+
+	group.msBeforeHeadingChange -= msElapsed;
+
+	if (group.msBeforeHeadingChange <= 0) {
+		group.heading = fmod(group.heading + (hashToUnit(g, group.nbHeadingChanges) - 0.5f) * 180.f, 360.f);
+		group.nbHeadingChanges++;
+		group.msBeforeHeadingChange += HERD_AGGREGATE_MS_BEFORE_HEADING_CHANGE;
+	}
+
+	glm::vec2 direction(cos(group.heading * RAD), sin(group.heading * RAD));
+	glm::vec2 newCentroid = group.centroid + direction * HERD_AGGREGATE_SPEED * (msElapsed / 1000.f);
+	// The front of the herd must stay on land too
+	glm::vec2 front = newCentroid + direction * std::max(group.spread, HERD_AGGREGATE_MIN_SPREAD);
+
+	if (front.x < 0.f || front.y < 0.f || front.x >= MAX_COORD || front.y >= MAX_COORD ||
+	    _terrainGeometry.isWater(front, 0))
+		group.heading = fmod(group.heading + 180.f, 360.f);
+
+	else
+		group.centroid = newCentroid;
+}
+
+void HerdStore::buildGrid(const std::vector<bool>& activeChunks) {
+	size_t nbCells = _gridSize * _gridSize;
+	_gridStarts.assign(nbCells + 1, 0);
+
+	// The cell of each animal, or nbCells if it does not take part in this frame
+	_gridCells.assign(_positions.size(), nbCells);
+
+	for (size_t g = 0; g < _groups.size(); g++) {
+		if (_groups[g].collapsed)
+			continue;
+
+		for (size_t i = _groups[g].first; i < _groups[g].first + _groups[g].count; i++) {
+			glm::uvec2 chunkPos = ut::convertToChunkCoords(_positions[i]);
+
+			if (!_dead[i] && activeChunks[chunkPos.x * NB_CHUNKS + chunkPos.y]) {
+				int x = glm::clamp((int) (_positions[i].x / HERD_LINE_OF_SIGHT), 0, _gridSize-1);
+				int y = glm::clamp((int) (_positions[i].y / HERD_LINE_OF_SIGHT), 0, _gridSize-1);
+				_gridCells[i] = x * _gridSize + y;
+				_gridStarts[_gridCells[i] + 1]++;
+			}
+		}
+	}
+
+	for (size_t c = 0; c < nbCells; c++) {
+		_gridStarts[c+1] += _gridStarts[c];
+	}
+
+	_gridAnimals.resize(_gridStarts[nbCells]);
+	_nextInCell.assign(_gridStarts.begin(), _gridStarts.end() - 1);
+
+	for (size_t i = 0; i < _positions.size(); i++) {
+		if (_gridCells[i] != nbCells)
+			_gridAnimals[_nextInCell[_gridCells[i]]++] = i;
+	}
+}
+
+bool HerdStore::neighbourListsExpired(const std::vector<bool>& activeChunks) const {
+	if (_simulatedHerdsChanged || _listsPositions.size() != _positions.size() || activeChunks != _listsActiveChunks)
+		return true;
+
+	float maxDisplacement2 = HERD_NEIGHBOURS_SKIN * HERD_NEIGHBOURS_SKIN / 4.f;
+
+	for (size_t k = 0; k < _gridAnimals.size(); k++) {
+		glm::vec2 displacement = _positions[_gridAnimals[k]] - _listsPositions[_gridAnimals[k]];
+
+		if (glm::dot(displacement, displacement) > maxDisplacement2)
+			return true;
+	}
+
+	return false;
+}
+
+void HerdStore::buildNeighbourLists(const std::vector<bool>& activeChunks) {
+	buildGrid(activeChunks);
+
+	_listsPositions = _positions;
+	_listsActiveChunks = activeChunks;
+	_simulatedHerdsChanged = false;
+	_nbNeighbourListsBuilds++;
+
+	float listRadius2 = (HERD_ATTRACTION_RADIUS + HERD_NEIGHBOURS_SKIN) * (HERD_ATTRACTION_RADIUS + HERD_NEIGHBOURS_SKIN);
+
+	_neighbourStarts.resize(_gridAnimals.size() + 1);
+	_neighbourLists.clear();
+
+	for (size_t n = 0; n < _gridAnimals.size(); n++) {
+		uint32_t i = _gridAnimals[n];
+		glm::vec2 pos = _positions[i];
+		_neighbourStarts[n] = _neighbourLists.size();
+
+		int cellX = glm::clamp((int) (pos.x / HERD_LINE_OF_SIGHT), 0, _gridSize-1);
+		int cellY = glm::clamp((int) (pos.y / HERD_LINE_OF_SIGHT), 0, _gridSize-1);
+
+		for (int x = std::max(0, cellX-1); x <= std::min(_gridSize-1, cellX+1); x++) {
+		for (int y = std::max(0, cellY-1); y <= std::min(_gridSize-1, cellY+1); y++) {
+			size_t cell = x * _gridSize + y;
+
+			for (uint32_t k = _gridStarts[cell]; k < _gridStarts[cell+1]; k++) {
+				uint32_t j = _gridAnimals[k];
+				glm::vec2 diff = _positions[j] - pos;
+
+				if (j != i && glm::dot(diff, diff) < listRadius2)
+					_neighbourLists.push_back(j);
+			}
+		}
+		}
+	}
+
+	_neighbourStarts[_gridAnimals.size()] = _neighbourLists.size();
+}
+
+void HerdStore::updateBehaviours(const std::vector<bool>& activeChunks, const std::vector<glm::vec2>& predators) {
+	if (neighbourListsExpired(activeChunks))
+		buildNeighbourLists(activeChunks);
+
+	_wokenUp.clear();
+	_wakeTimers.advance(_msNow, _wokenUp);
+
+	for (size_t k = 0; k < _wokenUp.size(); k++) {
+		// The timers of the animals woken up earlier are out of date
+		if (_msWakeTimes[_wokenUp[k]] <= _msNow)
+			_asleep[_wokenUp[k]] = false;
+	}
+
+	wakeUpAround(predators);
+	_nbEvaluated = 0;
+
+	// In the order of the grid, the neighbours of consecutive animals are the same
+	for (size_t n = 0; n < _gridAnimals.size(); n++) {
+		size_t i = _gridAnimals[n];
+
+		if (_dead[i] || _asleep[i])
+			continue;
+
+		updateBehaviour(n, predators);
+		_nbEvaluated++;
+
+		if (_statuses[i] == AntilopeStatus::IDLE)
+			sleepUntilNextPhase(i);
+	}
+}
+
+void HerdStore::wakeUpAround(const std::vector<glm::vec2>& predators) {
+	if (_gridStarts.empty())
+		return;
+
+	// The animals may have left their cell by half the skin since the grid was built
+	float cellsRange = HERD_LINE_OF_SIGHT + HERD_NEIGHBOURS_SKIN / 2.f;
+
+	for (size_t p = 0; p < predators.size(); p++) {
+		glm::vec2 pos = predators[p];
+		int minX = std::max(0, (int) ((pos.x - cellsRange) / HERD_LINE_OF_SIGHT));
+		int minY = std::max(0, (int) ((pos.y - cellsRange) / HERD_LINE_OF_SIGHT));
+		int maxX = std::min(_gridSize-1, (int) ((pos.x + cellsRange) / HERD_LINE_OF_SIGHT));
+		int maxY = std::min(_gridSize-1, (int) ((pos.y + cellsRange) / HERD_LINE_OF_SIGHT));
+
+		for (int x = minX; x <= maxX; x++) {
+		for (int y = minY; y <= maxY; y++) {
+			size_t cell = x * _gridSize + y;
+
+			for (uint32_t k = _gridStarts[cell]; k < _gridStarts[cell+1]; k++) {
+				uint32_t j = _gridAnimals[k];
+
+				if (glm::length(pos - _positions[j]) < HERD_LINE_OF_SIGHT)
+					_asleep[j] = false;
+			}
+		}
+		}
+	}
+}
+
+void HerdStore::sleepUntilNextPhase(size_t i) {
+	// Until the next end of one of its timers, an idle animal only reacts to the predators
+	int msWakeTime = INT_MAX;
+
+	if (_msPhaseEnds[i] > _msNow)
+		msWakeTime = _msPhaseEnds[i];
+
+	if (_msDirChangesAllowed[i] > _msNow)
+		msWakeTime = std::min(msWakeTime, _msDirChangesAllowed[i]);
+
+	// Both have ended without changing anything, it happens when the animal follows its neighbours
+	if (msWakeTime == INT_MAX)
+		msWakeTime = _msNow + HERD_MS_AVERAGE_BEFORE_CHANGING_DIR;
+
+	_asleep[i] = true;
+
+	// The timer is still in the wheel if it has been woken up by a predator
+	if (msWakeTime != _msWakeTimes[i] || _msWakeTimes[i] <= _msNow) {
+		_msWakeTimes[i] = msWakeTime;
+		_wakeTimers.schedule(i, msWakeTime);
+	}
+}
+
+void HerdStore::updateBehaviour(size_t n, const std::vector<glm::vec2>& predators) {
+	size_t i = _gridAnimals[n];
+	glm::vec2 pos = _positions[i];
+
+	BoidsInfo info;
+	info.minFleeDst = HERD_PANIC_FLEE_RADIUS;
+	_neighbours.clear();
+
+	for (uint32_t k = _neighbourStarts[n]; k < _neighbourStarts[n+1]; k++) {
+		uint32_t j = _neighbourLists[k];
+
+		if (!_dead[j])
+			_neighbours.push(_positions[j], _directions[j]);
+	}
+
+	computeBoidsInfo(pos, _neighbours, HERD_REPULSION_RADIUS, HERD_ORIENTATION_RADIUS, HERD_ATTRACTION_RADIUS, info);
+
+	for (size_t p = 0; p < predators.size(); p++) {
+		float distance = glm::length(pos - predators[p]);
+
+		if (distance < _linesOfSight[i]) {
+			if (distance < info.minFleeDst) {
+				info.closestFlee = predators[p];
+				info.minFleeDst = distance;
+			}
+
+			info.sumPosFlee += predators[p];
+			info.nbFlee++;
+		}
+	}
+
+	switch (_statuses[i]) {
+		case AntilopeStatus::IDLE:
+			if (info.nbFlee != 0)
+				beginFleeing(i);
+
+			if (info.nbAttract != 0 && info.nbAttract <= 2)
+				setDirection(i, info.sumPosAttract / (float) info.nbAttract - pos);
+
+			else if (_msPhaseEnds[i] <= _msNow) {
+				if (_moving[i]) {
+					_speeds[i] = 0.f;
+					_moving[i] = false;
+					launchAnimation(i, ANM_TYPE::WAIT);
+					_msPhaseEnds[i] = _msNow + generateTimePhase(HERD_MS_AVERAGE_EATING);
+				}
+
+				else {
+					if (info.minRepDst != HERD_REPULSION_RADIUS) // There is someone inside the repulsion radius
+						setDirection(i, pos - info.closestRep);
+
+					else {
+						float theta = randomUnit() * 2.f * M_PI;
+						setDirection(i, glm::vec2(cos(theta), sin(theta)));
+					}
+
+					_speeds[i] = HERD_SPEED_WALKING;
+					_moving[i] = true;
+					launchAnimation(i, ANM_TYPE::WALK);
+					_msPhaseEnds[i] = _msNow + generateTimePhase(HERD_MS_AVERAGE_FINDING_FOOD);
+				}
+			}
+			break;
+
+		case AntilopeStatus::FLEEING:
+			if (info.nbFlee != 0) {
+				if (info.minFleeDst != HERD_PANIC_FLEE_RADIUS)
+					setDirection(i, pos - (info.closestFlee + info.sumPosFlee) / (float) (info.nbFlee+1));
+
+				else
+					setDirection(i, pos - info.sumPosFlee / (float) info.nbFlee);
+			}
+
+			else if (info.minRepDst != HERD_REPULSION_RADIUS)
+				setDirection(i, pos - info.closestRep);
+
+			else if (info.nbDir != 0) {
+				glm::vec2 meanDir = info.sumOfDirs / (float) info.nbDir;
+				if (meanDir.x != 0 && meanDir.y != 0)
+					setDirection(i, meanDir);
+
+				else
+					setDirection(i, glm::vec2(1,0));
+			}
+
+			else if (info.nbAttract != 0)
+				setDirection(i, info.sumPosAttract / (float) info.nbAttract - pos);
+
+			if (info.nbFlee == 0)
+				beginRecovering(i);
+			break;
+
+		case AntilopeStatus::RECOVERING:
+			if (info.nbFlee != 0)
+				beginFleeing(i);
+
+			else if (_msPhaseEnds[i] <= _msNow)
+				beginIdle(i);
+
+			else if (info.minRepDst != HERD_REPULSION_RADIUS &&
+					(_boidStatuses[i] == BoidStatus::REPULSION || glm::length(pos - info.closestRep) < HERD_REPULSION_RADIUS * 0.8) ) {
+				setDirection(i, pos - info.closestRep);
+				_boidStatuses[i] = BoidStatus::REPULSION;
+			}
+
+			else if (info.nbDir != 0) {
+				glm::vec2 meanDir = info.sumOfDirs / (float) info.nbDir;
+				if (meanDir.x != 0 && meanDir.y != 0)
+					setDirection(i, meanDir);
+
+				else
+					setDirection(i, glm::vec2(1,0));
+
+				_boidStatuses[i] = BoidStatus::ORIENTATION;
+			}
+
+			else if (info.nbAttract != 0 &&
+					(_boidStatuses[i] == BoidStatus::ATTRACTION ||
+					 glm::length(info.sumPosAttract / (float) info.nbAttract - pos) < HERD_ATTRACTION_RADIUS * 0.8) ) {
+				setDirection(i, info.sumPosAttract / (float) info.nbAttract - pos);
+				_boidStatuses[i] = BoidStatus::ATTRACTION;
+			}
+			break;
+	}
+}
+
+void HerdStore::beginIdle(size_t i) {
+	if (_statuses[i] != AntilopeStatus::IDLE)
+		_timesChangedDir[i] = 0;
+	_statuses[i] = AntilopeStatus::IDLE;
+	_linesOfSight[i] = HERD_LINE_OF_SIGHT * 0.8f;
+	_speeds[i] = 0.f;
+	_moving[i] = false;
+	launchAnimation(i, ANM_TYPE::WAIT);
+}
+
+void HerdStore::beginFleeing(size_t i) {
+	if (_statuses[i] != AntilopeStatus::FLEEING)
+		_timesChangedDir[i] = 0;
+	_statuses[i] = AntilopeStatus::FLEEING;
+	_linesOfSight[i] = HERD_LINE_OF_SIGHT;
+	_speeds[i] = HERD_SPEED_RUNNING;
+	_moving[i] = true;
+	launchAnimation(i, ANM_TYPE::RUN);
+}
+
+void HerdStore::beginRecovering(size_t i) {
+	if (_statuses[i] != AntilopeStatus::RECOVERING)
+		_timesChangedDir[i] = 0;
+	_statuses[i] = AntilopeStatus::RECOVERING;
+	_linesOfSight[i] = HERD_LINE_OF_SIGHT * 0.9f;
+	_speeds[i] = HERD_SPEED_WALKING;
+	_moving[i] = true;
+	launchAnimation(i, ANM_TYPE::WALK);
+	_msPhaseEnds[i] = _msNow + generateTimePhase(HERD_MS_AVERAGE_RECOVERING);
+}
+
+int HerdStore::generateTimePhase(int msAverage) {
+	return msAverage + randomUnit() * msAverage * 0.8f - msAverage * 0.4f;
+}
+
+void HerdStore::setDirection(size_t i, glm::vec2 direction) {
+	if (_msDirChangesAllowed[i] > _msNow)
+		return;
+
+	float length = glm::length(direction);
+
+	if (length != 0) {
+		_directions[i] = direction / length;
+		_headings[i] = atan2(direction.y, direction.x) / RAD;
+	}
+
+	else
+		_directions[i] = glm::vec2(0.f);
+
+	int msTimeBeforeChangingDir = generateTimePhase(HERD_MS_AVERAGE_BEFORE_CHANGING_DIR);
+
+	// if the antilope has been fleeing for a long time, it will try its luck
+	// by going for a longer time towards the same direction
+	if (_statuses[i] == AntilopeStatus::FLEEING)
+		msTimeBeforeChangingDir += 200.f * _timesChangedDir[i];
+
+	_timesChangedDir[i]++;
+
+	_msDirChangesAllowed[i] = _msNow + msTimeBeforeChangingDir;
+}
+
+void HerdStore::beginTick() {
+	for (size_t g = 0; g < _groups.size(); g++) {
+		if (_groups[g].collapsed)
+			continue;
+
+		for (size_t i = _groups[g].first; i < _groups[g].first + _groups[g].count; i++) {
+			_previousPositions[i] = _positions[i];
+		}
+	}
+}
+
+void HerdStore::move(int msElapsed) {
+	// The timers of the animals are times of this clock, nothing to update for them
+	_msNow += msElapsed;
+
+	for (size_t g = 0; g < _groups.size(); g++) {
+		if (_groups[g].collapsed)
+			continue;
+
+		for (size_t i = _groups[g].first; i < _groups[g].first + _groups[g].count; i++) {
+			if (_speeds[i] == 0.f || (_directions[i].x == 0.f && _directions[i].y == 0.f))
+				continue;
+
+			glm::vec2 newPos = _positions[i] + _directions[i] * _speeds[i] * (msElapsed / 1000.f);
+
+			if (_terrainGeometry.isWater(newPos, 0)) {
+				if (!_dead[i]) {
+					setDirection(i, glm::vec2(0.f));
+					launchAnimation(i, ANM_TYPE::WAIT);
+				}
+			}
+
+			else
+				_positions[i] = newPos;
+		}
+	}
+}
+
+void HerdStore::launchAnimation(size_t i, ANM_TYPE type) {
+	if (!_dead[i] && _anims[i] != type) {
+		_anims[i] = type;
+		_sprites[i] = 0;
+		_msInAnim[i] = 0;
+	}
+}
+
+void HerdStore::updateAnimations(int msElapsed) {
+	for (size_t g = 0; g < _groups.size(); g++) {
+		if (_groups[g].collapsed)
+			continue;
+
+		for (size_t i = _groups[g].first; i < _groups[g].first + _groups[g].count; i++) {
+			updateAnimation(i, msElapsed);
+		}
+	}
+}
+
+void HerdStore::updateAnimation(size_t i, int msElapsed) {
+	const AnimInfo& anm = _species[_speciesIndices[i]].animInfo[(int) _anims[i]];
+
+	// We make sure that the elapsed time does not extend one loop
+	int msTotalAnimDuration = anm.steps * anm.msDuration + anm.msPause;
+	_msInAnim[i] = (_msInAnim[i] + msElapsed) % msTotalAnimDuration;
+
+	int nextSprite = _sprites[i] + _msInAnim[i] / anm.msDuration;
+
+	// Simple case, no restart to handle
+	if (nextSprite < anm.steps) {
+		_msInAnim[i] -= (nextSprite - _sprites[i]) * anm.msDuration;
+		_sprites[i] = nextSprite;
+	}
+
+	else if (!anm.loop)
+		_sprites[i] = anm.steps-1;
+
+	else {
+		_msInAnim[i] -= (anm.steps-1 - _sprites[i]) * anm.msDuration;
+
+		// The sprite is in the pause
+		if (_msInAnim[i] < anm.msPause)
+			_sprites[i] = anm.steps-1;
+
+		// The sprite has started a new loop
+		else {
+			_msInAnim[i] -= anm.msPause;
+			nextSprite = _msInAnim[i] / anm.msDuration;
+			_msInAnim[i] -= nextSprite * anm.msDuration;
+			_sprites[i] = nextSprite;
+		}
+	}
+}
+
+glm::vec4 HerdStore::getSpriteRect(size_t i, float theta) const {
+	const AnimInfo& anm = _species[_speciesIndices[i]].animInfo[(int) _anims[i]];
+
+	// Angle between the front of the sprite and the camera
+	float orientation = fmod(_headings[i] - theta, 360.f);
+	if (orientation < 0.f)
+		orientation += 360.f;
+
+	float oriStep = 360.f / (float) anm.orientations;
+	int orient = (anm.orientations - (int) round(orientation / oriStep)) % anm.orientations;
+
+	glm::vec4 spriteRect = anm.spriteRect;
+	spriteRect.x += _sprites[i] * spriteRect.z;
+	spriteRect.y += orient * spriteRect.w;
+
+	return spriteRect;
+}
+
+void HerdStore::appendSprites(const std::vector<bool>& visibleChunks, float theta, float alpha, std::vector<Sprite>& sprites) const {
+	// One species after the other, so that each one is a single spree
+	for (size_t s = 0; s < _species.size(); s++) {
+		const HerdSpecies& species = _species[s];
+
+		for (size_t g = 0; g < _groups.size(); g++) {
+		if (_groups[g].collapsed || _speciesIndices[_groups[g].first] != s)
+			continue;
+
+		for (size_t i = _groups[g].first; i < _groups[g].first + _groups[g].count; i++) {
+			glm::uvec2 chunkPos = ut::convertToChunkCoords(_positions[i]);
+
+			if (!visibleChunks[chunkPos.x * NB_CHUNKS + chunkPos.y])
+				continue;
+
+			int anim = (int) _anims[i];
+
+			Sprite sprite;
+			sprite.pos = glm::vec3(glm::mix(_previousPositions[i], _positions[i], alpha), 0.f);
+			sprite.size = species.sizes[anim];
+			sprite.offsetY = species.offsets[anim];
+			sprite.texRect = getSpriteRect(i, theta);
+			sprite.layer = species.animInfo[anim].texLayer;
+			sprite.texArray = species.init->getTexArray();
+			sprites.push_back(sprite);
+		}
+		}
+	}
+}
@@ -0,0 +1,197 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <random>
+#include <stddef.h> // size_t
+#include <stdint.h>
+#include <vector>
+
+#include "animationManagerInitializer.h"
+#include "boidsKernel.h"
+#include "igElementDisplay.h"
+#include "terrainGeometry.h"
+#include "timerWheel.h"
+
+// Cell size of the neighbour grid, no animal reacts to something farther
+#define HERD_LINE_OF_SIGHT 60.f
+
+enum class AntilopeStatus {IDLE, FLEEING, RECOVERING};
+enum class BoidStatus {REPULSION, ORIENTATION, ATTRACTION};
+
+#define ANM_TYPE_NB 5
+
+// The animals are never removed from the store, the dead ones stay as corpses,
+// so the handle of an animal stays valid as long as the store exists
+struct HerdHandle {
+	uint32_t index;
+
+	inline bool operator==(const HerdHandle& other) const {return index == other.index;}
+	inline bool operator!=(const HerdHandle& other) const {return index != other.index;}
+};
+
+#define INVALID_HERD_HANDLE HerdHandle{UINT32_MAX}
+
+// The animals of a herd are consecutive in the store and of the same species. Far from the camera the herd is
+// collapsed: its animals are frozen and only the aggregate below is simulated
+struct HerdGroup {
+	uint32_t first;
+	uint32_t count;
+	uint32_t nbAlive;
+	bool collapsed;
+
+	// Aggregate, only updated while collapsed
+	glm::vec2 centroid;
+	float spread; // Root mean square distance of the living animals to the centroid
+	float heading; // In degrees, as the headings of the animals
+	int msBeforeHeadingChange;
+	uint32_t nbHeadingChanges;
+};
+
+// Animation data shared by the animals of a species
+struct HerdSpecies {
+	const AnimationManagerInitializer* init;
+	std::array<AnimInfo, ANM_TYPE_NB> animInfo;
+	// Size of the sprite and offset of its bottom, which depend on the animation
+	std::array<glm::vec2, ANM_TYPE_NB> sizes;
+	std::array<float, ANM_TYPE_NB> offsets;
+};
+
+/** Stores the herd animals (antilopes, deers) as arrays of components instead of objects.
+  * Each frame walks the arrays in order: the systems (behaviours, motion,
+  * animation, display) are loops over the components they need, and the
+  * neighbours are found with a grid rebuilt each frame by a counting sort.
+  * The herds out of the active chunks are simulated as aggregates, so that the
+  * cost of a frame follows the number of animals near the camera.
+  * The idle animals sleep in a timer wheel until the end of their phase, or
+  * until a predator comes close, and are not evaluated in between.
+  */
+class HerdStore {
+public:
+	HerdStore(const TerrainGeometry& terrainGeometry);
+
+	void addHerd(const std::vector<glm::vec2>& positions, const AnimationManagerInitializer& species);
+	inline size_t size() const {return _positions.size();}
+	inline size_t getNbAlive() const {return _nbAlive;}
+	inline size_t getNbHerds() const {return _groups.size();}
+	inline size_t getNbCollapsedHerds() const {return _nbCollapsedGroups;}
+	// Animals of the herds that are not collapsed
+	inline size_t getNbSimulated() const {return _positions.size() - _nbCollapsedAnimals;}
+
+	inline glm::vec2 getPos(HerdHandle animal) const {return _positions[animal.index];}
+	inline float getSpeed(HerdHandle animal) const {return _speeds[animal.index];}
+	inline bool isDead(HerdHandle animal) const {return _dead[animal.index];}
+	void kill(HerdHandle animal);
+
+	// Closest living animal within range of pos, INVALID_HERD_HANDLE if there is none
+	// Uses the grid of the last updateBehaviours, only the active animals are found
+	HerdHandle findClosest(glm::vec2 pos, float range) const;
+	// Linear search among the herds, the collapsed ones are seen as disks around their centroid
+	bool hasAliveAnimalWithin(glm::vec2 pos, float range) const;
+
+	// activeChunks tells for each chunk (index x * NB_CHUNKS + y) whether its animals react to their
+	// neighbours. The predators are the positions of the living lions of these chunks
+	// Collapses the herds that left the active chunks, moves the aggregates and expands
+	// the ones that came back. To call before the other systems of the tick
+	void updateSimulationLod(const std::vector<bool>& activeChunks, int msElapsed);
+	void updateBehaviours(const std::vector<bool>& activeChunks, const std::vector<glm::vec2>& predators);
+	inline size_t getNbNeighbourListsBuilds() const {return _nbNeighbourListsBuilds;}
+	// Animals whose behaviour was evaluated by the last updateBehaviours, the others were asleep or inactive
+	inline size_t getNbEvaluated() const {return _nbEvaluated;}
+	// Called before each simulation tick, the sprites blend the positions before and after the last one
+	void beginTick();
+	void move(int msElapsed);
+	void updateAnimations(int msElapsed);
+	// Appends the sprites of the animals of the visible chunks, their height is left to the caller
+	// alpha is the fraction of the next tick already elapsed
+	void appendSprites(const std::vector<bool>& visibleChunks, float theta, float alpha, std::vector<Sprite>& sprites) const;
+
+private:
+	size_t registerSpecies(const AnimationManagerInitializer& init);
+	void addAnimal(glm::vec2 pos, size_t species, uint32_t group);
+
+	bool touchesActiveChunks(glm::vec2 min, glm::vec2 max, const std::vector<bool>& activeChunks) const;
+	void collapse(size_t g);
+	// The layout only depends on the aggregate and on g, a herd comes back the same way whatever the frame rate
+	void expand(size_t g);
+	void advanceAggregate(size_t g, int msElapsed);
+	void buildGrid(const std::vector<bool>& activeChunks);
+	// True if an animal has moved by half the skin since the lists were built, or if the active animals changed
+	bool neighbourListsExpired(const std::vector<bool>& activeChunks) const;
+	void buildNeighbourLists(const std::vector<bool>& activeChunks);
+	// n is the index of the animal in _gridAnimals
+	void updateBehaviour(size_t n, const std::vector<glm::vec2>& predators);
+	void wakeUpAround(const std::vector<glm::vec2>& predators);
+	void sleepUntilNextPhase(size_t i);
+
+	void beginIdle(size_t i);
+	void beginFleeing(size_t i);
+	void beginRecovering(size_t i);
+	void launchAnimation(size_t i, ANM_TYPE type);
+	void updateAnimation(size_t i, int msElapsed);
+	void setDirection(size_t i, glm::vec2 direction);
+	int generateTimePhase(int msAverage);
+	inline float randomUnit() {return _unitDistribution(_random);}
+	glm::vec4 getSpriteRect(size_t i, float theta) const;
+
+	const TerrainGeometry& _terrainGeometry;
+	std::vector<HerdSpecies> _species;
+	size_t _nbAlive;
+
+	std::vector<HerdGroup> _groups;
+	std::vector<uint32_t> _groupIndices; // Herd of each animal
+	size_t _nbCollapsedGroups;
+	size_t _nbCollapsedAnimals;
+	bool _simulatedHerdsChanged; // Expires the neighbour lists
+
+	// Motion
+	std::vector<glm::vec2> _positions;
+	std::vector<glm::vec2> _previousPositions; // Before the last simulation tick
+	std::vector<glm::vec2> _directions; // Normalized, or null
+	std::vector<float> _speeds; // Distance per second
+	std::vector<float> _headings; // Angle of the last direction with (1,0), in degrees
+
+	// Behaviour
+	std::vector<uint8_t> _dead;
+	std::vector<uint8_t> _moving;
+	std::vector<AntilopeStatus> _statuses;
+	std::vector<BoidStatus> _boidStatuses;
+	std::vector<float> _linesOfSight; // Changes the standard line of sight to add hysteresis
+	std::vector<int> _msPhaseEnds;
+	std::vector<int> _msDirChangesAllowed;
+	std::vector<int> _timesChangedDir;
+
+	// Sleep, the times are the ones of _msNow, advanced once per tick by move
+	int _msNow;
+	// Not the global rand, shared with the other threads
+	std::mt19937 _random;
+	std::uniform_real_distribution<float> _unitDistribution;
+	std::vector<uint8_t> _asleep;
+	std::vector<int> _msWakeTimes;
+	TimerWheel _wakeTimers;
+	std::vector<uint32_t> _wokenUp; // By the last advance
+	size_t _nbEvaluated;
+
+	// Animation
+	std::vector<uint8_t> _speciesIndices;
+	std::vector<ANM_TYPE> _anims;
+	std::vector<int> _sprites;
+	std::vector<int> _msInAnim;
+
+	// Neighbour grid: the active animals of cell c are _gridAnimals[_gridStarts[c] .. _gridStarts[c+1]]
+	// It is rebuilt with the neighbour lists, the animals may have moved since
+	int _gridSize;
+	std::vector<uint32_t> _gridStarts;
+	std::vector<uint32_t> _gridAnimals;
+	std::vector<uint32_t> _gridCells; // Of each animal
+	std::vector<uint32_t> _nextInCell;
+
+	// Verlet lists: the neighbours of _gridAnimals[n] are _neighbourLists[_neighbourStarts[n] .. _neighbourStarts[n+1]]
+	std::vector<uint32_t> _neighbourStarts;
+	std::vector<uint32_t> _neighbourLists;
+	std::vector<glm::vec2> _listsPositions;
+	std::vector<bool> _listsActiveChunks;
+	size_t _nbNeighbourListsBuilds;
+	BoidsNeighbours _neighbours; // Of the animal evaluated
+};
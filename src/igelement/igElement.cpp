@@ -6,15 +6,26 @@
 #include "camera.h"
 #include "utils.h"
 
-igElement::igElement(glm::vec2 position) :
+igElement::igElement(glm::vec2 position, ElementKind kind, FactionMask factions) :
 	_pos(position),
 	_size(0.f),
 	_offset(0.f),
-	_camOrientation(0.f) {
+	_camOrientation(0.f),
+	_kind(kind),
+	_factions(factions) {
 
 	_orientation = RANDOMF * 360.f;
 }
 
+igElement::igElement(glm::vec2 position, float orientation, ElementKind kind, FactionMask factions) :
+	_pos(position),
+	_size(0.f),
+	_offset(0.f),
+	_camOrientation(0.f),
+	_orientation(orientation),
+	_kind(kind),
+	_factions(factions) {}
+
 void igElement::updateDisplay(int msElapsed, float theta) {
 	setOrientation(_orientation + _camOrientation - theta); // Orientation moves opposite to the camera
 
@@ -30,10 +41,10 @@ void igElement::setVertices() {
 	_vertices[9] = 0; _vertices[10] =  _size.x/2 + _offset.x; _vertices[11] =       0 + _offset.y;
 }
 
-void igElement::setPosArray() {
+void igElement::setPosArray(glm::vec2 displayedPos) {
 	for (int i = 0; i < 4; i++) {
-		_posArray[3*i]     = _pos.x;
-		_posArray[3*i + 1] = _pos.y;
+		_posArray[3*i]     = displayedPos.x;
+		_posArray[3*i + 1] = displayedPos.y;
 		_posArray[3*i + 2] = _height;
 	}
 }
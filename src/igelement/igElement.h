@@ -6,13 +6,25 @@
 
 #include <array>
 #include <stddef.h> // size_t
+#include <stdint.h>
 #include <string>
 
 // ig = ingame
 
+// Concrete class of an element, read instead of using dynamic_cast in the loops over the elements
+enum class ElementKind : uint8_t {TREE, FOREST_IMPOSTOR, CONTROLLABLE, LION};
+
+// Sides an element belongs to, they can be combined
+typedef uint8_t FactionMask;
+#define FACTION_NONE     0
+#define FACTION_FLORA    (1 << 0)
+#define FACTION_HUMAN    (1 << 1)
+#define FACTION_PREDATOR (1 << 2)
+
 class igElement {
 public:
-	igElement(glm::vec2 position);
+	igElement(glm::vec2 position, ElementKind kind, FactionMask factions);
+	igElement(glm::vec2 position, float orientation, ElementKind kind, FactionMask factions);
 
 	virtual void updateDisplay(int msElapsed, float theta);
 	inline void setHeight(float height) {_height = height; setPosArray();}
@@ -21,6 +33,11 @@ public:
 
 	virtual const TextureArray* getTexArray() const = 0;
 
+	inline ElementKind getKind() const {return _kind;}
+	inline bool hasFaction(FactionMask factions) const {return (_factions & factions) != 0;}
+	// Controllable or derived from it
+	inline bool isControllable() const {return _kind == ElementKind::CONTROLLABLE || _kind == ElementKind::LION;}
+
 	inline glm::vec2 getPos() const {return _pos;}
 	inline float getHeight() const {return _height;}
 	inline float getOrientation() const {return _orientation;}
@@ -33,7 +50,8 @@ public:
 
 protected:
 	void setVertices(); // Uses the _size attribute
-	void setPosArray();
+	void setPosArray() {setPosArray(_pos);}
+	void setPosArray(glm::vec2 displayedPos); // The displayed position can lag behind _pos
 	void setTexCoord(glm::vec4 rect);
 	void setLayer(size_t layer);
 	void setOrientation(float nOrientation);
@@ -53,4 +71,6 @@ protected:
 
 private:
 	float _orientation; // Angle between the front of the sprite and the camera
+	ElementKind _kind;
+	FactionMask _factions;
 };
@@ -2,7 +2,6 @@
 
 #include <cmath>
 
-#include "igMovingElement.h"
 #include "tree.h"
 #include "utils.h"
 
@@ -17,25 +16,33 @@ void igElementDisplay::fillBufferData(GLenum drawType) {
 
   VertexBufferObject::unbind();
 
-  // ibo
+  // ibo, the indices of fewer elements are the beginning of the ones uploaded
 
-  _ibo.bind();
+  if (_capacity > _nbIndexedElements) {
+    _ibo.bind();
 
-  std::vector<GLuint> indices(6*_capacity);
+    std::vector<GLuint> indices(6*_capacity);
 
-  for (int i = 0; i < _capacity; i++) {
-    indices[6*i]     = 0 + 4*i;
-    indices[6*i + 1] = 1 + 4*i;
-    indices[6*i + 2] = 2 + 4*i;
-    indices[6*i + 3] = 0 + 4*i;
-    indices[6*i + 4] = 2 + 4*i;
-    indices[6*i + 5] = 3 + 4*i;
-  }
+    for (int i = 0; i < _capacity; i++) {
+      indices[6*i]     = 0 + 4*i;
+      indices[6*i + 1] = 1 + 4*i;
+      indices[6*i + 2] = 2 + 4*i;
+      indices[6*i + 3] = 0 + 4*i;
+      indices[6*i + 4] = 2 + 4*i;
+      indices[6*i + 5] = 3 + 4*i;
+    }
 
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, _capacity * 6 * sizeof(indices[0]), &indices[0], GL_STATIC_DRAW);
-  IndexBufferObject::unbind();
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, _capacity * 6 * sizeof(indices[0]), &indices[0], GL_STATIC_DRAW);
+    IndexBufferObject::unbind();
+    _nbIndexedElements = _capacity;
+  }
 
   _vao.bind();
+  setAttributes();
+  VertexArrayObject::unbind();
+}
+
+void igElementDisplay::setAttributes() const {
   _vbo.bind();
 
   size_t sizeVertices = _capacity * 12 * sizeof(float);
@@ -52,6 +59,20 @@ void igElementDisplay::fillBufferData(GLenum drawType) {
   glEnableVertexAttribArray(3);
 
   VertexBufferObject::unbind();
+}
+
+void igElementDisplay::setupVertexArray(const VertexArrayObject& vao, const VertexBufferObject& heightOffsets) const {
+  if (_capacity == 0)
+    return;
+
+  vao.bind();
+  setAttributes();
+
+  heightOffsets.bind();
+  glVertexAttribPointer(4, 1, GL_FLOAT, GL_FALSE, 0, BUFFER_OFFSET(0));
+  glEnableVertexAttribArray(4);
+  VertexBufferObject::unbind();
+
   VertexArrayObject::unbind();
 }
 
@@ -85,10 +106,19 @@ void igElementDisplay::processSpree(const std::vector<igElement*>& elemsToDispla
 enum class CurrentType {NO_TYPE, ANIMAL, TREE};
 
 void igElementDisplay::loadElements(const std::vector<igElement*>& visibleElmts, bool onlyOnce) {
+  prepareElements(visibleElmts);
+  uploadElements(onlyOnce);
+}
+
+void igElementDisplay::prepareElements(const std::vector<igElement*>& visibleElmts) {
+  prepareElements(visibleElmts, std::vector<Sprite>());
+}
+
+void igElementDisplay::prepareElements(const std::vector<igElement*>& visibleElmts, const std::vector<Sprite>& sprites) {
   _textures.clear();
   _nbElemsInSpree.clear();
 
-  _capacity = visibleElmts.size();
+  _capacity = visibleElmts.size() + sprites.size();
   _data.resize(_capacity * 36);
 
   size_t currentSpreeLength = 0;
@@ -99,10 +129,11 @@ void igElementDisplay::loadElements(const std::vector<igElement*>& visibleElmts,
   Biome       currentBiome = Biome::BIOME_NB_ITEMS;
 
   for (int i = 0; i < visibleElmts.size(); i++) {
-    Tree* tree = dynamic_cast<Tree*>(visibleElmts[i]);
-    igMovingElement* animal = dynamic_cast<igMovingElement*>(visibleElmts[i]);
+    ElementKind kind = visibleElmts[i]->getKind();
+
+    if (kind == ElementKind::TREE) {
+      const Tree* tree = static_cast<const Tree*>(visibleElmts[i]);
 
-    if (tree) {
       if (currentType != CurrentType::TREE || currentBiome != tree->getBiome()) {
         processSpree(visibleElmts, currentSpreeLength, firstIndexSpree);
         currentType  = CurrentType::TREE;
@@ -110,11 +141,11 @@ void igElementDisplay::loadElements(const std::vector<igElement*>& visibleElmts,
       }
     }
 
-    else if (animal) {
-      if (currentType != CurrentType::ANIMAL || currentTexture != animal->getTexArray()) {
+    else if (visibleElmts[i]->isControllable()) {
+      if (currentType != CurrentType::ANIMAL || currentTexture != visibleElmts[i]->getTexArray()) {
         processSpree(visibleElmts, currentSpreeLength, firstIndexSpree);
         currentType   = CurrentType::ANIMAL;
-        currentTexture = animal->getTexArray();
+        currentTexture = visibleElmts[i]->getTexArray();
       }
     }
 
@@ -123,16 +154,64 @@ void igElementDisplay::loadElements(const std::vector<igElement*>& visibleElmts,
 
   processSpree(visibleElmts, currentSpreeLength, firstIndexSpree);
 
-  if (onlyOnce)
+  // Consecutive sprites sharing a texture are drawn together
+  for (size_t i = 0; i < sprites.size(); i++) {
+    if (i == 0 || sprites[i].texArray != sprites[i-1].texArray) {
+      _textures.push_back(sprites[i].texArray);
+      _nbElemsInSpree.push_back(0);
+    }
+
+    fillSpriteData(sprites[i], visibleElmts.size() + i);
+    _nbElemsInSpree.back()++;
+  }
+}
+
+void igElementDisplay::fillSpriteData(const Sprite& sprite, size_t index) {
+  // Same layout as igElement::setVertices, setPosArray, setTexCoord and setLayer
+  float* vertices = &_data[index*12];
+  vertices[0] = 0; vertices[1]  =  sprite.size.x/2; vertices[2]  = sprite.size.y + sprite.offsetY;
+  vertices[3] = 0; vertices[4]  = -sprite.size.x/2; vertices[5]  = sprite.size.y + sprite.offsetY;
+  vertices[6] = 0; vertices[7]  = -sprite.size.x/2; vertices[8]  =             0 + sprite.offsetY;
+  vertices[9] = 0; vertices[10] =  sprite.size.x/2; vertices[11] =             0 + sprite.offsetY;
+
+  float* posArray = &_data[_capacity*12 + index*12];
+  for (int i = 0; i < 4; i++) {
+    posArray[3*i]     = sprite.pos.x;
+    posArray[3*i + 1] = sprite.pos.y;
+    posArray[3*i + 2] = sprite.pos.z;
+  }
+
+  const glm::vec4& rect = sprite.texRect;
+  float* coord2D = &_data[_capacity*24 + index*8];
+  coord2D[0] = rect.x + rect.z; coord2D[1] = rect.y;
+  coord2D[2] = rect.x;          coord2D[3] = rect.y;
+  coord2D[4] = rect.x;          coord2D[5] = rect.y + rect.w;
+  coord2D[6] = rect.x + rect.z; coord2D[7] = rect.y + rect.w;
+
+  float* layer = &_data[_capacity*32 + index*4];
+  for (int i = 0; i < 4; i++) {
+    layer[i] = sprite.layer;
+  }
+}
+
+void igElementDisplay::uploadElements(bool onlyOnce) {
+  if (onlyOnce) {
     fillBufferData(GL_STATIC_DRAW);
+    std::vector<float>().swap(_data);
+  }
+
   else
     fillBufferData(GL_DYNAMIC_DRAW);
 }
 
 size_t igElementDisplay::drawElements() const {
+  return drawElements(_vao);
+}
+
+size_t igElementDisplay::drawElements(const VertexArrayObject& vao) const {
   size_t cursor = 0;
 
-  _vao.bind();
+  vao.bind();
   _ibo.bind();
 
   for (int i = 0; i < _nbElemsInSpree.size(); i++) {
@@ -8,21 +8,50 @@
 
 #include "igElement.h"
 
+// Element displayed without an igElement object, e.g. stored in a HerdStore
+struct Sprite {
+  glm::vec3 pos;
+  glm::vec2 size;
+  float offsetY; // Of the bottom of the sprite
+  glm::vec4 texRect;
+  float layer;
+  const TextureArray* texArray;
+};
+
 class igElementDisplay {
 public:
   igElementDisplay() {}
 
   void loadElements(const std::vector<igElement*>& visibleElmts, bool onlyOnce = false);
+  // loadElements in two steps: the preparation does not use OpenGL and can be done on another thread
+  void prepareElements(const std::vector<igElement*>& visibleElmts);
+  // The sprites are displayed after the elements, in the same buffers
+  void prepareElements(const std::vector<igElement*>& visibleElmts, const std::vector<Sprite>& sprites);
+  // The data on the CPU is released if the elements are uploaded only once
+  void uploadElements(bool onlyOnce = false);
   size_t drawElements() const;
 
+  // The same elements can be drawn at different heights: the vertex array uses the buffers of
+  // the elements and adds heightOffsets (one float per vertex, 4 per element) to their heights
+  void setupVertexArray(const VertexArrayObject& vao, const VertexBufferObject& heightOffsets) const;
+  size_t drawElements(const VertexArrayObject& vao) const;
+
+  inline size_t getNbElements() const {return _capacity;}
+  // Memory used by the elements, in bytes
+  inline size_t getCPUMemory() const {return _data.capacity() * sizeof(float);}
+  inline size_t getGPUMemory() const {return _capacity * 36 * sizeof(float) + _nbIndexedElements * 6 * sizeof(GLuint);}
+
 protected:
   void fillBufferData(GLenum drawType);
+  void setAttributes() const;
   void processSpree(const std::vector<igElement*>& visibleElmts,
     size_t& currentSpreeLength, size_t& firstIndexSpree);
+  void fillSpriteData(const Sprite& sprite, size_t index);
 
   void reset();
 
   size_t _capacity = 0;
+  size_t _nbIndexedElements = 0; // The index buffer is only uploaded again when the capacity exceeds it
   bool _fixedCapacity = false;
 
   std::vector<float> _data;
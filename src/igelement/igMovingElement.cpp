@@ -4,11 +4,14 @@
 #include <glm/gtx/vector_angle.hpp>
 #include <cmath>
 
-igMovingElement::igMovingElement(glm::vec2 position, AnimationManager graphics, const TerrainGeometry& terrainGeometry) :
-	igElement(position),
+igMovingElement::igMovingElement(glm::vec2 position, AnimationManager graphics, const TerrainGeometry& terrainGeometry,
+	ElementKind kind, FactionMask factions) :
+	igElement(position, kind, factions),
 	_dead(false),
 	_graphics(graphics),
 	_terrainGeometry(terrainGeometry),
+	_handle(INVALID_SLOT_HANDLE),
+	_previousPos(position),
 	_direction(0.f) {
 	_size = _graphics.getRawSize();
 	_size /= _size.y;
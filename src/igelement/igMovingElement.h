@@ -4,17 +4,25 @@
 
 #include "animationManager.h"
 #include "igElement.h"
+#include "slotMap.h"
 #include "terrainGeometry.h"
 
+class HerdStore;
+
 class igMovingElement : public igElement {
 public:
-	igMovingElement(glm::vec2 position, AnimationManager graphics, const TerrainGeometry& terrainGeometry);
+	igMovingElement(glm::vec2 position, AnimationManager graphics, const TerrainGeometry& terrainGeometry,
+	                ElementKind kind, FactionMask factions);
 
 	void launchAnimation (ANM_TYPE type);
 	virtual void updateDisplay(int msElapsed, float theta); // Update sprite
-	virtual void update(int msElapsed); // Update pos and inner statuses
+	virtual void update(int msElapsed); // Update pos and inner statuses, msElapsed is a simulation tick
+	// Called before each simulation tick, the display blends the positions before and after the last one
+	inline void beginTick() {_previousPos = _pos;}
+	inline glm::vec2 getDisplayedPos(float alpha) const {return glm::mix(_previousPos, _pos, alpha);}
+	inline void setDisplayedPos(glm::vec2 pos, float height) {_height = height; setPosArray(pos);}
 	// React to the environment
-	virtual void updateState(const std::list<igMovingElement*>& neighbors) {(void) neighbors;}
+	virtual void updateState(HerdStore& herds) {(void) herds;}
 	virtual void die();
 	virtual void stop();
 
@@ -24,6 +32,9 @@ public:
 	inline glm::vec2 getDirection() const {return _direction;}
 	inline float getSpeed() const {return _speed;}
 	inline bool isDead() const {return _dead;}
+	// Handle of the element in the Engine, which sets it
+	inline SlotHandle getHandle() const {return _handle;}
+	inline void setHandle(SlotHandle handle) {_handle = handle;}
 
 protected:
 	virtual void setDirection(glm::vec2 direction);
@@ -36,6 +47,9 @@ protected:
 	const TerrainGeometry& _terrainGeometry;
 
 private:
+	SlotHandle _handle;
+	glm::vec2 _previousPos;
+
 	// Normalized vector towards the target
 	// It is private to guarantee a correct normalization
 	glm::vec2 _direction;
@@ -1,11 +1,9 @@
 #include "lion.h"
 
-#include "antilope.h"
-
 size_t Lion::_nbKilled = 0;
 
 Lion::Lion(glm::vec2 position, AnimationManager graphics, const TerrainGeometry& terrainGeometry) :
-	Controllable(position, graphics, terrainGeometry),
+	Controllable(position, graphics, terrainGeometry, ElementKind::LION, FACTION_PREDATOR),
 	_stamina(100),
 	_catchBreathSpeed(25.f),
 	_loseBreathSpeed(10.f),
@@ -14,6 +12,9 @@ Lion::Lion(glm::vec2 position, AnimationManager graphics, const TerrainGeometry&
 	_rangeAttack(8.f),
 	_rangeChase(13.f),
 	_status(LionStatus::WAITING),
+	_prey(INVALID_HERD_HANDLE),
+	_herds(nullptr),
+	_msSinceAttack(0),
 	_msAnimAttack(2.0f * graphics.getAnimationTime(ANM_TYPE::ATTACK)-150) {
 
 	_speed = _speedWalking;
@@ -28,19 +29,21 @@ void Lion::update(int msElapsed) {
 		}
 
 		if (_status == LionStatus::CHASING) {
-			_target = _prey->getPos();
-			setDirection(_prey->getPos() - _pos);
+			_target = _herds->getPos(_prey);
+			setDirection(_herds->getPos(_prey) - _pos);
 		}
 	}
 
 	else if (_status == LionStatus::ATTACKING) {
-		_target = _prey->getPos();
-		setDirection(_prey->getPos() - _pos);
+		_target = _herds->getPos(_prey);
+		setDirection(_herds->getPos(_prey) - _pos);
+
+		_speed = _herds->getSpeed(_prey) * 0.8f;
 
-		_speed = _prey->getSpeed() * 0.8f;
+		_msSinceAttack += msElapsed;
 
-		if (_beginAttack.getElapsedTime() >= _msAnimAttack) {
-			_prey->die();
+		if (_msSinceAttack >= _msAnimAttack) {
+			_herds->kill(_prey);
 			stop();
 			_nbKilled++;
 		}
@@ -82,7 +85,7 @@ void Lion::beginAttacking() {
 		_status = LionStatus::ATTACKING;
 		_speed = 0.f;
 		launchAnimation(ANM_TYPE::ATTACK);
-		_beginAttack.restart();
+		_msSinceAttack = 0;
 	}
 }
 
@@ -106,30 +109,13 @@ void Lion::setTarget(glm::vec2 t, ANM_TYPE anim) {
 		Controllable::setTarget(t,ANM_TYPE::WALK);
 }
 
-void Lion::updateState(const std::list<igMovingElement*>& neighbors) {
-	float distance;
-	igMovingElement* closest = nullptr;
-	float nearestDist = _rangeChase;
-
-	for (auto it = neighbors.begin(); it != neighbors.end(); it++) {
-		if (*it != this) {
-			Antilope *atlp = dynamic_cast<Antilope*>(*it);
-			if (atlp) {
-				distance = glm::length(_pos - atlp->getPos());
-
-				if (distance < _rangeChase) {
-					if (distance < nearestDist) {
-						nearestDist = distance;
-						closest = atlp;
-					}
-				}
-			}
-		}
-	}
+void Lion::updateState(HerdStore& herds) {
+	_herds = &herds;
+	HerdHandle closest = herds.findClosest(_pos, _rangeChase);
 
-	if (closest) {
+	if (closest != INVALID_HERD_HANDLE) {
 		_prey = closest;
-		if (nearestDist < _rangeAttack)
+		if (glm::length(_pos - herds.getPos(closest)) < _rangeAttack)
 			beginAttacking();
 		else
 			beginChasing();
@@ -1,10 +1,9 @@
 #pragma once
 
-#include <list>
 #include <stddef.h> // size_t
 
 #include "controllable.h"
-#include "clock.h"
+#include "herdStore.h"
 
 enum class LionStatus {WAITING, WALKING, RUNNING, ATTACKING, CHASING};
 
@@ -14,7 +13,7 @@ public:
 
 	virtual void update(int msElapsed);
 	// React to the environment
-	virtual void updateState(const std::list<igMovingElement*>& neighbors);
+	virtual void updateState(HerdStore& herds);
 
 	virtual void stop();
 	void beginRunning();
@@ -42,7 +41,8 @@ private:
 
 	LionStatus _status;
 
-	igMovingElement* _prey;
-	Clock _beginAttack;
+	HerdHandle _prey;
+	HerdStore* _herds; // Store of the prey
+	int _msSinceAttack; // Advanced by update, the attack lasts as many ticks whatever the frame rate
 	const int _msAnimAttack;
 };
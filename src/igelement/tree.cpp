@@ -1,8 +1,8 @@
 #include "tree.h"
 #include "animationManager.h"
 
-Tree::Tree(glm::vec2 position, const TreeTexManager& manager, Biome biome, int index) :
-	igElement(position),
+Tree::Tree(glm::vec2 position, const TreeTexManager& manager, Biome biome, int index, float orientation) :
+	igElement(position, orientation, ElementKind::TREE, FACTION_FLORA),
 	_manager(manager),
 	_biome(biome),
 	_index(index) {
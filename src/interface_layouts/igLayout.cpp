@@ -127,21 +127,21 @@ void igLayout::renderRectSelect() const {
   _rectSelect.bindShaderAndDraw();
 }
 
-void igLayout::renderStaminaBars(std::set<Lion*> selection) const {
+void igLayout::renderStaminaBars(const std::vector<StaminaBar>& bars) const {
   std::vector<glm::ivec4> staminaBarsRects;
   std::vector<glm::ivec4> outlinesRects;
 
-  for(auto it = selection.begin(); it != selection.end(); ++it) {
-    glm::ivec4 corners = (*it)->getScreenRect();
+  for(auto it = bars.begin(); it != bars.end(); ++it) {
+    glm::ivec4 corners = it->screenRect;
 
     // Otherwise the selected element is outside the screen
     if (corners.z != 0) {
-      float maxHeightFactor = (*it)->getMaxHeightFactor(); // The lifeBar must not change when switching animations
+      float maxHeightFactor = it->maxHeightFactor; // The lifeBar must not change when switching animations
 
       staminaBarsRects.push_back(glm::ivec4(
         corners.x + corners.z/2 - interfaceParams.staminaBarWidth() / 2.f,
         corners.y - corners.w*maxHeightFactor + corners.w - interfaceParams.staminaBarWidth() / 4.f,
-        interfaceParams.staminaBarWidth() * (*it)->getStamina() / 100.f,
+        interfaceParams.staminaBarWidth() * it->stamina / 100.f,
         interfaceParams.staminaBarHeight()
       ));
 
@@ -1,6 +1,6 @@
 #pragma once
 
-#include <set>
+#include <vector>
 
 #include "camera.h"
 #include "chronometer.h"
@@ -14,6 +14,13 @@
 #include "texture.h"
 #include "texturedRectangle.h"
 
+// What a stamina bar needs from its lion, copied before the simulation thread updates the lions
+struct StaminaBar {
+  glm::ivec4 screenRect;
+  float maxHeightFactor;
+  float stamina;
+};
+
 class igLayout {
 public:
   igLayout();
@@ -23,7 +30,7 @@ public:
   void renderMinimap(const Engine& engine) const;
   void renderText() const;
   void renderRectSelect() const;
-  void renderStaminaBars(std::set<Lion*> selection) const;
+  void renderStaminaBars(const std::vector<StaminaBar>& bars) const;
 
   glm::vec2 getMinimapClickCoords(const glm::ivec2& clickPos) const;
   void setTextTopLeft(const std::string& string);
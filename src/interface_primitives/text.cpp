@@ -4,8 +4,6 @@
 #include "coordConversion.h"
 #include "texturedRectangle.h"
 
-#include <vector>
-
 FontHandler Text::_fontHandler;
 Shader Text::_textShader;
 bool Text::_shaderLoaded = false;
@@ -62,14 +60,13 @@ void Text::setText(const std::string &str, float fontSize, float leading) {
   _stringLength = str.size();
   size_t glyphGLDataSize = 24;
 
-  std::vector<float> bufferData(_stringLength * glyphGLDataSize);
+  // The line breaks and the missing glyphs stay at zero
+  _bufferData.assign(_stringLength * glyphGLDataSize, 0.f);
 
   for (int i = 0; i < str.size(); i++) {
     if (str[i] == '\n') {
       y -= _fontHandler.getFontSize() * sy * leading;
       x = -1;
-      std::vector<float> clearChar(glyphGLDataSize,0);
-      VertexBufferObject::cpuBufferSubData(bufferData, i * glyphGLDataSize, glyphGLDataSize, &clearChar[0]);
     }
 
     else {
@@ -97,7 +94,7 @@ void Text::setText(const std::string &str, float fontSize, float leading) {
         { x0, y0, s0, t0 }, { x1, y1, s1, t1 }, { x1, y0, s1, t0 }
       };
 
-      VertexBufferObject::cpuBufferSubData(bufferData, i * glyphGLDataSize, glyphGLDataSize, data);
+      VertexBufferObject::cpuBufferSubData(_bufferData, i * glyphGLDataSize, glyphGLDataSize, data);
 
       x += (glyph->advance_x * sx);
     }
@@ -106,7 +103,7 @@ void Text::setText(const std::string &str, float fontSize, float leading) {
       maxX = x;
   }
 
-  glBufferData(GL_ARRAY_BUFFER, bufferData.size() * sizeof(float), &bufferData[0], GL_DYNAMIC_DRAW);
+  glBufferData(GL_ARRAY_BUFFER, _bufferData.size() * sizeof(float), _bufferData.data(), GL_DYNAMIC_DRAW);
 
   _bounds.x = maxX;
   _bounds.y = y;
@@ -9,6 +9,7 @@
 
 #include <stddef.h> // size_t
 #include <string>
+#include <vector>
 
 class Text {
 public:
@@ -34,6 +35,7 @@ private:
   Texture _texture;
 
   size_t _stringLength;
+  std::vector<float> _bufferData;
   glm::vec2 _origin;
   glm::vec2 _bounds;
 };
@@ -3,22 +3,38 @@
 #include <SDL_log.h>
 
 FrameBufferObject::FrameBufferObject() :
-  _fboID(0) {
+  _fboID(0),
+  _width(0),
+  _height(0),
+  _colorRenderBuffer(0),
+  _depthRenderBuffer(0) {
   glGenFramebuffers(1, &_fboID);
 }
 
 FrameBufferObject::~FrameBufferObject () {
   glDeleteFramebuffers(1, &_fboID);
+  glDeleteRenderbuffers(1, &_colorRenderBuffer);
+  glDeleteRenderbuffers(1, &_depthRenderBuffer);
 }
 
 FrameBufferObject::FrameBufferObject (FrameBufferObject&& other) noexcept:
   _fboID(other._fboID),
+  _width(other._width),
+  _height(other._height),
   _colorBuffer(std::move(other._colorBuffer)),
-  _depthBuffer(std::move(other._depthBuffer)) {}
+  _depthBuffer(std::move(other._depthBuffer)),
+  _colorRenderBuffer(other._colorRenderBuffer),
+  _depthRenderBuffer(other._depthRenderBuffer) {
+  other._colorRenderBuffer = 0;
+  other._depthRenderBuffer = 0;
+}
 
 void FrameBufferObject::init(size_t width, size_t height,
   GLenum colorBufferInternalFormat, GLenum colorBufferFormat, GLenum colorBufferType) {
 
+  _width = width;
+  _height = height;
+
   _colorBuffer.bind();
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
@@ -37,8 +53,48 @@ void FrameBufferObject::init(size_t width, size_t height,
   _colorBuffer.attachToBoundFBO(GL_COLOR_ATTACHMENT0);
   _depthBuffer.attachToBoundFBO(GL_DEPTH_ATTACHMENT);
 
+  checkStatus();
+
+  unbind();
+}
+
+void FrameBufferObject::initMultisample(size_t width, size_t height, size_t samples, GLenum colorBufferInternalFormat) {
+  _width = width;
+  _height = height;
+
+  glGenRenderbuffers(1, &_colorRenderBuffer);
+  glBindRenderbuffer(GL_RENDERBUFFER, _colorRenderBuffer);
+  glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, colorBufferInternalFormat, width, height);
+
+  glGenRenderbuffers(1, &_depthRenderBuffer);
+  glBindRenderbuffer(GL_RENDERBUFFER, _depthRenderBuffer);
+  glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, GL_DEPTH_COMPONENT24, width, height);
+
+  glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+  bind();
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, _colorRenderBuffer);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, _depthRenderBuffer);
+
+  checkStatus();
+
+  unbind();
+}
+
+void FrameBufferObject::resolveInto(const FrameBufferObject& target) const {
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, _fboID);
+  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, target._fboID);
+
+  // The depth cannot be filtered
+  glBlitFramebuffer(0, 0, _width, _height, 0, 0, target._width, target._height,
+                    GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+
+  unbind();
+}
+
+bool FrameBufferObject::checkStatus() const {
   if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
-    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Error in FrameBufferObject::init, unable to create FBO");
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Error in FrameBufferObject, unable to create FBO");
     switch (glCheckFramebufferStatus(GL_FRAMEBUFFER)) {
       case GL_FRAMEBUFFER_UNDEFINED:                     SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "GL_FRAMEBUFFER_UNDEFINED"); break;
       case GL_FRAMEBUFFER_INCOMPLETE_ATTACHMENT:         SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "GL_FRAMEBUFFER_INCOMPLETE_ATTACHMENT"); break;
@@ -51,7 +107,9 @@ void FrameBufferObject::init(size_t width, size_t height,
       case GL_FRAMEBUFFER_INCOMPLETE_LAYER_TARGETS:      SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "GL_FRAMEBUFFER_INCOMPLETE_LAYER_TARGETS"); break;
 #endif
     }
+
+    return false;
   }
 
-  unbind();
+  return true;
 }
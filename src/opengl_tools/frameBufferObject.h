@@ -12,6 +12,12 @@ public:
 
   void init(size_t width, size_t height,
     GLenum colorBufferInternalFormat, GLenum colorBufferFormat, GLenum colorBufferType);
+  // The buffers of a multisampled FBO are render buffers: they cannot be sampled and
+  // have to be resolved into a regular FBO of the same size
+  void initMultisample(size_t width, size_t height, size_t samples, GLenum colorBufferInternalFormat);
+  void resolveInto(const FrameBufferObject& target) const;
+
+  inline bool isInitialized() const {return _width != 0;}
 
   inline const Texture* getColorBuffer() const {return &_colorBuffer;}
   inline const Texture* getDepthTexture() const {return &_depthBuffer;}
@@ -20,7 +26,13 @@ public:
   static void unbind() {glBindFramebuffer(GL_FRAMEBUFFER, 0);}
 
 private:
+  bool checkStatus() const;
+
   GLuint _fboID;
+  size_t _width;
+  size_t _height;
   Texture _colorBuffer;
   Texture _depthBuffer;
+  GLuint _colorRenderBuffer;
+  GLuint _depthRenderBuffer;
 };
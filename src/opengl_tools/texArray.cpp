@@ -71,3 +71,26 @@ void TextureArray::loadTextures(size_t count, std::string folderPath) {
 		unbind();
 	}
 }
+
+void TextureArray::allocate(size_t count, glm::uvec2 size) {
+	_count = count;
+	_maxTexSize = size;
+	_texSizes.assign(count, glm::vec2(size));
+
+	bind();
+
+	glTexStorage3D(GL_TEXTURE_2D_ARRAY, 1, GL_RGBA8, size.x, size.y, count);
+
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	unbind();
+}
+
+void TextureArray::copyFromBoundFBO(size_t layer) const {
+	bind();
+	glCopyTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, 0, 0, _maxTexSize.x, _maxTexSize.y);
+	unbind();
+}
@@ -15,6 +15,10 @@ public:
 	~TextureArray();
 
 	void loadTextures(size_t count, std::string folderPath);
+	// Storage for count textures of the same size rendered at runtime, without mipmaps
+	void allocate(size_t count, glm::uvec2 size);
+	// Copies the color buffer of the bound framebuffer, from its origin, into a layer
+	void copyFromBoundFBO(size_t layer) const;
 
 	// Returns the size of the current texture relative to the size of the array texture
 	inline glm::vec4 getTexRectangle(size_t index) const {
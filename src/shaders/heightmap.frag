@@ -9,7 +9,15 @@ layout (location = 0) out vec3 fragColor;
 
 uniform sampler2D tex;
 
+// Debug view: each fragment shaded adds the same color, blended additively
+uniform bool overdrawView;
+
 void main() {
+	if (overdrawView) {
+		fragColor = vec3(0.1, 0.04, 0.f);
+		return;
+	}
+
 	fragColor = texture( tex, texCoords ).rgb *
 		(0.5 + 0.5*dot(lightDir,normal));
 }
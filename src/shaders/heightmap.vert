@@ -3,14 +3,18 @@
 layout (location = 0) in vec3 in_Vertex;
 layout (location = 1) in vec3 in_Normal;
 layout (location = 2) in vec2 in_TexCoords;
+layout (location = 3) in float in_CoarseHeight;
 
 out vec2 texCoords;
 out vec3 normal;
 
 uniform mat4 MVP;
+uniform float morphFactor;
 
 void main(){
-	gl_Position =  MVP * vec4(in_Vertex,1);
+	// Geomorphing between the height on the coarser level and the actual one
+	float height = mix(in_CoarseHeight, in_Vertex.z, morphFactor);
+	gl_Position =  MVP * vec4(in_Vertex.xy, height, 1);
 
 	texCoords = in_TexCoords;
 	normal = in_Normal;
@@ -12,10 +12,20 @@ uniform sampler2DArray tex;
 
 uniform bool onlyOpaqueParts;
 
+// The fragments are kept if their dither value is in [x,y), so that two representations
+// with complementary ranges crossfade without blending
+uniform vec2 keptRange;
+
 void main() {
 	if (discardFrag > 0.f)
 		discard;
 
+	// Interleaved gradient noise, fixed in screen space
+	float dither = fract(52.9829189 * fract(dot(gl_FragCoord.xy, vec2(0.06711056, 0.00583715))));
+
+	if (dither < keptRange.x || dither >= keptRange.y)
+		discard;
+
 	fragColor = texture(tex, vec3(texCoords, layer));
 
 	if (onlyOpaqueParts) {
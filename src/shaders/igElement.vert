@@ -4,6 +4,8 @@ layout (location = 0) in vec3 in_Vertex;
 layout (location = 1) in vec3 in_Pos;
 layout (location = 2) in vec2 in_TexCoords;
 layout (location = 3) in float in_Layer;
+// Height of the terrain level displayed compared to the one of in_Pos, 0 if the array is disabled
+layout (location = 4) in float in_HeightOffset;
 
 out vec2 texCoords;
 out float layer;
@@ -18,12 +20,14 @@ uniform float elementNearPlane;
 uniform vec3 camPos;
 
 void main(){
-	if (length(in_Pos-camPos) < elementNearPlane)
+	vec3 pos = in_Pos + vec3(0, 0, in_HeightOffset);
+
+	if (length(pos-camPos) < elementNearPlane)
 		discardFrag = 1.f;
 	else
 		discardFrag = 0.f;
 
-	gl_Position = VP * (vec4(in_Pos,0) + MODEL * vec4(in_Vertex,1));
+	gl_Position = VP * (vec4(pos,0) + MODEL * vec4(in_Vertex,1));
 
 	texCoords = in_TexCoords;
 	layer = in_Layer;
@@ -1,59 +1,123 @@
 #include "chunk.h"
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
 #include "camera.h"
 
+// Upper bound of the height of the moving elements
+#define CHUNK_MIN_CONTENT_HEIGHT 20.f
+
+// Maximum error of the displayed terrain on screen, in pixels
+#ifdef __ANDROID__
+	#define CHUNK_MAX_SCREEN_ERROR 4.f
+#else
+	#define CHUNK_MAX_SCREEN_ERROR 2.f
+#endif
+// A level coarser than the current one is chosen only if its error is below this fraction of the maximum
+#define CHUNK_LOD_HYSTERESIS 0.75f
+// Deviation between levels 1 and 2 assumed before it is measured, each level then halves it
+#define CHUNK_DEFAULT_LEVEL_DEVIATION 16.f
+#define CHUNK_MIN_SKIRT_DEPTH 10.f
+// The trees are replaced by the impostors between these distances, the impostors are baked a bit closer
+#define CHUNK_IMPOSTORS_START_DIST 5000.f
+#define CHUNK_IMPOSTORS_END_DIST 6500.f
+#define CHUNK_IMPOSTORS_BAKE_DIST 4000.f
+
 Chunk::Chunk(size_t x, size_t y, const TerrainTexManager& terrainTexManager,
 	TerrainGeometry& terrainGeometry,
-	ChunkSubdivider& chunkSubdivider) :
+	ChunkSubdivider& chunkSubdivider,
+	ChunkLodCache& lodCache,
+	ChunkUploadScheduler& uploadScheduler) :
 	_chunkPos(x, y),
 	_centerOfChunk(0.f),
+	_boundingBoxMin(std::numeric_limits<float>::max()),
+	_boundingBoxMax(- std::numeric_limits<float>::max()),
 	_visible(false),
+	_terrainOccluded(false),
+	_contentOccluded(false),
 	_treesNeedTwoPasses(false),
 	_displayMovingElements(false),
 	_currentSubdivLvl(1),
 	_maxSubdivLvlAvailable(1),
 	_maxSubdivLvlAsked(1),
+	_targetSubdivLvl(1),
+	_morphFactor(1.f),
+	_hasPrefetchTasks(false),
+	_nbPrefetchHits(0),
+	_nbPrefetchMisses(0),
   _terrainTexManager(terrainTexManager),
   _terrainGeometry(terrainGeometry),
-	_chunkSubdivider(chunkSubdivider) {
+	_chunkSubdivider(chunkSubdivider),
+	_lodCache(lodCache),
+	_uploadScheduler(uploadScheduler),
+	_forestAsked(false),
+	_forestReceived(false),
+	_impostorsNeeded(false),
+	_impostorsBaked(false),
+	_impostorBlend(0.f),
+	_maxContentHeight(CHUNK_MIN_CONTENT_HEIGHT) {
 
 	for (int i = 0; i < MAX_SUBDIV_LVL+1; i++) {
     _subdivisionLevels.push_back(std::unique_ptr<Buffers>(new Buffers()));
   }
+
+	_levelDeviations.fill(-1.f);
 }
 
-void Chunk::fillBufferData(size_t subdivLvl) {
+size_t Buffers::getCPUMemory() const {
+	size_t res = (vertices.capacity() + vertexData.capacity()) * sizeof(float) + indexData.capacity() * sizeof(GLuint);
+
+	for (auto it = indicesInfo.begin(); it != indicesInfo.end(); it++) {
+		res += it->second.indices.capacity() * sizeof(GLuint);
+	}
+
+	return res + treeHeightOffsets.capacity() * sizeof(float);
+}
+
+void Chunk::fillBufferData(SubdivisionResult& result, float skirtDepth) const {
+	size_t subdivLvl = result.subdivLvl;
+
 	std::list<const Triangle*> triangles = _terrainGeometry.getTrianglesInChunk(_chunkPos.x, _chunkPos.y, subdivLvl);
 	std::list<Vertex*> vertices = TerrainGeometry::SubdivisionLevel::getVertices(triangles);
 
-	Buffers* currentBuffers = _subdivisionLevels[subdivLvl].get();
-
-	currentBuffers->vertices.resize(vertices.size() * 3);
-	currentBuffers->normals.resize(vertices.size() * 3);
-	currentBuffers->coords.resize(vertices.size() * 2);
+	result.vertices.resize(vertices.size() * 3);
+	result.normals.resize(vertices.size() * 3);
+	result.coords.resize(vertices.size() * 2);
+	result.coarseHeights.resize(vertices.size());
 
 	std::map<Vertex*, size_t> verticesArrayIndices;
 
 	size_t vertIndex = 0;
+	float deviation = 0.f;
 
 	for (auto vert = vertices.begin(); vert != vertices.end(); vert++) {
 		for (int i = 0; i < 3; i++) {
-			currentBuffers->vertices[3*vertIndex + i] = (*vert)->pos[i];
-			currentBuffers->normals[3*vertIndex + i] = (*vert)->normal[i];
+			result.vertices[3*vertIndex + i] = (*vert)->pos[i];
+			result.normals[3*vertIndex + i] = (*vert)->normal[i];
 		}
 
-		currentBuffers->coords[2*vertIndex] =
+		result.coords[2*vertIndex] =
 		((*vert)->pos.x - CHUNK_SIZE*_chunkPos.x)/CHUNK_SIZE*TEX_FACTOR;
-		currentBuffers->coords[2*vertIndex + 1] =
+		result.coords[2*vertIndex + 1] =
 		((*vert)->pos.y - CHUNK_SIZE*_chunkPos.y)/CHUNK_SIZE*TEX_FACTOR;
 
+		// The vertices outside of the coarser level keep their height
+		result.coarseHeights[vertIndex] = subdivLvl > 1 ?
+			_terrainGeometry.getHeight(glm::vec2((*vert)->pos.x, (*vert)->pos.y), subdivLvl-1, (*vert)->pos.z) : (*vert)->pos.z;
+
+		deviation = std::max(deviation, std::abs((*vert)->pos.z - result.coarseHeights[vertIndex]));
+
 		verticesArrayIndices[*vert] = vertIndex;
 
 		vertIndex++;
 	}
 
+	result.deviation = subdivLvl > 1 ? deviation : -1.f;
+
 	for (auto tri = triangles.begin(); tri != triangles.end(); tri++) {
-		std::vector<GLuint>& currentIndices = currentBuffers->indicesInfo[(*tri)->biome].indices;
+		std::vector<GLuint>& currentIndices = result.indicesInfo[(*tri)->biome].indices;
 
 		currentIndices.resize(currentIndices.size() + 3);
 
@@ -61,26 +125,128 @@ void Chunk::fillBufferData(size_t subdivLvl) {
 			currentIndices[currentIndices.size()-3+i] = verticesArrayIndices.at((*tri)->vertices[i]);
 		}
 	}
+
+	addSkirts(result, triangles, verticesArrayIndices, skirtDepth);
 }
 
-void Chunk::generateBuffers() {
-	Buffers* currentBuffers = _subdivisionLevels[_currentSubdivLvl].get();
+struct BorderEdge {
+	Vertex* from; // The triangle is on the left of (from, to)
+	Vertex* to;
+	Biome biome;
+	int nbTriangles;
+};
+
+void Chunk::addSkirts(SubdivisionResult& result, const std::list<const Triangle*>& triangles,
+                      const std::map<Vertex*, size_t>& verticesArrayIndices, float skirtDepth) const {
+	// The edges of the mesh are the ones that belong to a single triangle
+	std::map<std::pair<Vertex*, Vertex*>, BorderEdge> edges;
+
+	for (auto tri = triangles.begin(); tri != triangles.end(); tri++) {
+		for (int i = 0; i < 3; i++) {
+			Vertex* from = (*tri)->vertices[i];
+			Vertex* to   = (*tri)->vertices[(i+1)%3];
+			std::pair<Vertex*, Vertex*> key(std::min(from, to), std::max(from, to));
+
+			auto edge = edges.find(key);
+
+			if (edge == edges.end())
+				edges[key] = {from, to, (*tri)->biome, 1};
+			else
+				edge->second.nbTriangles++;
+		}
+	}
+
+	glm::vec2 chunkMin(CHUNK_SIZE*_chunkPos.x, CHUNK_SIZE*_chunkPos.y);
+	glm::vec2 chunkMax = chunkMin + glm::vec2(CHUNK_SIZE);
+
+	// Index of the bottom of the skirt for each vertex of the border
+	std::map<size_t, size_t> skirtVertices;
 
-	if (currentBuffers->vertices.size() == 0)
+	for (auto it = edges.begin(); it != edges.end(); it++) {
+		const BorderEdge& edge = it->second;
+
+		if (edge.nbTriangles != 1)
+			continue;
+
+		// Edges inside the chunk are coasts, there is no neighbour there
+		glm::vec2 middle = 0.5f * glm::vec2(edge.from->pos.x + edge.to->pos.x, edge.from->pos.y + edge.to->pos.y);
+
+		if (middle.x > chunkMin.x + 1 && middle.x < chunkMax.x - 1 &&
+		    middle.y > chunkMin.y + 1 && middle.y < chunkMax.y - 1)
+			continue;
+
+		size_t top[2] = {verticesArrayIndices.at(edge.from), verticesArrayIndices.at(edge.to)};
+		size_t bottom[2];
+
+		for (int i = 0; i < 2; i++) {
+			auto skirtVertex = skirtVertices.find(top[i]);
+
+			if (skirtVertex != skirtVertices.end()) {
+				bottom[i] = skirtVertex->second;
+				continue;
+			}
+
+			bottom[i] = result.coarseHeights.size();
+			skirtVertices[top[i]] = bottom[i];
+
+			for (int j = 0; j < 3; j++) {
+				result.vertices.push_back(result.vertices[3*top[i] + j] - (j == 2 ? skirtDepth : 0.f));
+				result.normals.push_back(result.normals[3*top[i] + j]);
+			}
+
+			result.coords.push_back(result.coords[2*top[i]]);
+			result.coords.push_back(result.coords[2*top[i] + 1]);
+			result.coarseHeights.push_back(result.coarseHeights[top[i]] - skirtDepth);
+		}
+
+		// Facing outside of the mesh, which is on the right of (from, to)
+		std::vector<GLuint>& currentIndices = result.indicesInfo[edge.biome].indices;
+		GLuint skirtIndices[6] = {(GLuint) top[0], (GLuint) bottom[0], (GLuint) top[1],
+		                          (GLuint) top[1], (GLuint) bottom[0], (GLuint) bottom[1]};
+
+		currentIndices.insert(currentIndices.end(), skirtIndices, skirtIndices + 6);
+	}
+}
+
+void Chunk::fillUploadPacket(SubdivisionResult& result) const {
+	// Same layout as the VBO: all the positions, then the normals, the texture coordinates and the coarse heights
+	std::vector<float>& vertexData = result.vertexData;
+	vertexData.reserve(result.vertices.size() + result.normals.size() +
+	                   result.coords.size() + result.coarseHeights.size());
+
+	vertexData.insert(vertexData.end(), result.vertices.begin(),      result.vertices.end());
+	vertexData.insert(vertexData.end(), result.normals.begin(),       result.normals.end());
+	vertexData.insert(vertexData.end(), result.coords.begin(),        result.coords.end());
+	vertexData.insert(vertexData.end(), result.coarseHeights.begin(), result.coarseHeights.end());
+
+	// The indices of all the biomes share a single IBO
+	for (auto it = result.indicesInfo.begin(); it != result.indicesInfo.end(); it++) {
+		it->second.offset = result.indexData.size();
+		result.indexData.insert(result.indexData.end(), it->second.indices.begin(), it->second.indices.end());
+	}
+
+	// The positions are kept for the occlusion culling
+	std::vector<float>().swap(result.normals);
+	std::vector<float>().swap(result.coords);
+	std::vector<float>().swap(result.coarseHeights);
+}
+
+void Chunk::generateBuffers(size_t subdivLvl) {
+	Buffers* currentBuffers = _subdivisionLevels[subdivLvl].get();
+	currentBuffers->gpuMemory = 0;
+	currentBuffers->generated = true;
+
+	if (currentBuffers->vertexData.size() == 0)
 		return;
 
+	size_t nbVertices = currentBuffers->vertices.size() / 3;
+
 	// geometry VBO
 
 	currentBuffers->vbo.bind();
 
-	size_t bufferSizeVertices = currentBuffers->vertices.size()*sizeof currentBuffers->vertices[0];
-	size_t bufferSizeNormals	= currentBuffers->normals. size()*sizeof currentBuffers->normals[0];
-	size_t bufferSizeCoords		= currentBuffers->coords.  size()*sizeof currentBuffers->coords[0];
-
-	glBufferData(GL_ARRAY_BUFFER, bufferSizeVertices + bufferSizeNormals + bufferSizeCoords, NULL, GL_STATIC_DRAW);
-  glBufferSubData(GL_ARRAY_BUFFER, 0, bufferSizeVertices , &currentBuffers->vertices[0]);
-  glBufferSubData(GL_ARRAY_BUFFER,    bufferSizeVertices , bufferSizeNormals, &currentBuffers->normals[0]);
-	glBufferSubData(GL_ARRAY_BUFFER,    bufferSizeVertices + bufferSizeNormals, bufferSizeCoords, &currentBuffers->coords[0]);
+	size_t bufferSizeVertices = currentBuffers->vertexData.size()*sizeof currentBuffers->vertexData[0];
+	glBufferData(GL_ARRAY_BUFFER, bufferSizeVertices, &currentBuffers->vertexData[0], GL_STATIC_DRAW);
 
   VertexBufferObject::unbind();
 
@@ -90,87 +256,72 @@ void Chunk::generateBuffers() {
 	currentBuffers->vbo.bind();
 
 	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, BUFFER_OFFSET(0));
-  glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0,
-		BUFFER_OFFSET(currentBuffers->vertices.size()*sizeof currentBuffers->vertices[0]));
-	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 0,
-		BUFFER_OFFSET(currentBuffers->vertices.size()*sizeof currentBuffers->vertices[0] +
-		              currentBuffers->normals. size()*sizeof currentBuffers->normals[0]));
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, BUFFER_OFFSET(nbVertices * 3 * sizeof(float)));
+	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 0, BUFFER_OFFSET(nbVertices * 6 * sizeof(float)));
+	glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, 0, BUFFER_OFFSET(nbVertices * 8 * sizeof(float)));
 
 	glEnableVertexAttribArray(0);
 	glEnableVertexAttribArray(1);
 	glEnableVertexAttribArray(2);
+	glEnableVertexAttribArray(3);
 
 	VertexBufferObject::unbind();
 	VertexArrayObject::unbind();
 
-	// IBO for each biome
-
-	for (auto it = currentBuffers->indicesInfo.begin(); it != currentBuffers->indicesInfo.end(); it++) {
-		size_t bufferSizeIndices = it->second.indices.size()*sizeof it->second.indices[0];
+	// IBO
 
-		it->second.ibo = std::unique_ptr<IndexBufferObject>(new IndexBufferObject());
-		it->second.ibo->bind();
-
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, bufferSizeIndices, NULL, GL_STATIC_DRAW);
-		glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, bufferSizeIndices, &(it->second.indices[0]));
+	size_t bufferSizeIndices = currentBuffers->indexData.size()*sizeof currentBuffers->indexData[0];
 
+	if (bufferSizeIndices > 0) {
+		currentBuffers->ibo.bind();
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, bufferSizeIndices, &currentBuffers->indexData[0], GL_STATIC_DRAW);
 		IndexBufferObject::unbind();
 	}
 
-	currentBuffers->generated = true;
-}
+	currentBuffers->gpuMemory = bufferSizeVertices + bufferSizeIndices;
 
-void Chunk::computeChunkBoundingBox(size_t subdivLvl) {
-	Buffers* currentBuffers = _subdivisionLevels[subdivLvl].get();
-
-	float minCoord[3];
-	float maxCoord[3];
+	std::vector<float>().swap(currentBuffers->vertexData);
+	std::vector<GLuint>().swap(currentBuffers->indexData);
+}
 
-	for (int i = 0; i < 3; i++) {
-		minCoord[i] = std::numeric_limits<float>::max();
-		maxCoord[i] = - std::numeric_limits<float>::max();
-	}
+void Chunk::computeBoundingBox(SubdivisionResult& result) const {
+	result.boundingBoxMin = glm::vec3(std::numeric_limits<float>::max());
+	result.boundingBoxMax = glm::vec3(- std::numeric_limits<float>::max());
 
-	for (int i = 0; i < currentBuffers->vertices.size(); i+=3) {
+	for (int i = 0; i < result.vertices.size(); i+=3) {
 		for (int j = 0; j < 3; j++) {
-			if (currentBuffers->vertices[i+j] < minCoord[j])
-				minCoord[j] = currentBuffers->vertices[i+j];
-			if (currentBuffers->vertices[i+j] > maxCoord[j])
-				maxCoord[j] = currentBuffers->vertices[i+j];
+			if (result.vertices[i+j] < result.boundingBoxMin[j])
+				result.boundingBoxMin[j] = result.vertices[i+j];
+			if (result.vertices[i+j] > result.boundingBoxMax[j])
+				result.boundingBoxMax[j] = result.vertices[i+j];
 		}
 	}
 
-	currentBuffers->corners[0] = glm::vec3(minCoord[0], minCoord[1], minCoord[2]);
-	currentBuffers->corners[1] = glm::vec3(minCoord[0], minCoord[1], maxCoord[2]);
-	currentBuffers->corners[2] = glm::vec3(minCoord[0], maxCoord[1], minCoord[2]);
-	currentBuffers->corners[3] = glm::vec3(minCoord[0], maxCoord[1], maxCoord[2]);
-	currentBuffers->corners[4] = glm::vec3(maxCoord[0], minCoord[1], minCoord[2]);
-	currentBuffers->corners[5] = glm::vec3(maxCoord[0], minCoord[1], maxCoord[2]);
-	currentBuffers->corners[6] = glm::vec3(maxCoord[0], maxCoord[1], minCoord[2]);
-	currentBuffers->corners[7] = glm::vec3(maxCoord[0], maxCoord[1], maxCoord[2]);
-	_centerOfChunk = glm::vec3((_chunkPos.x+0.5)*CHUNK_SIZE, (_chunkPos.y+0.5)*CHUNK_SIZE,
-	    	 getHeight(glm::vec2((_chunkPos.x+0.5)*CHUNK_SIZE, (_chunkPos.y+0.5)*CHUNK_SIZE)));
+	result.centerHeight = getHeight(glm::vec2((_chunkPos.x+0.5)*CHUNK_SIZE, (_chunkPos.y+0.5)*CHUNK_SIZE), result.subdivLvl);
 }
 
 size_t Chunk::draw() const {
 	Buffers* currentBuffers = _subdivisionLevels[_currentSubdivLvl].get();
 
+	// Nothing uploaded yet
+	if (!currentBuffers->generated)
+		return 0;
+
 	currentBuffers->vao.bind();
+	currentBuffers->ibo.bind();
 
 	size_t nbTriangles = 0;
 
 	for (auto it = currentBuffers->indicesInfo.begin(); it != currentBuffers->indicesInfo.end(); it++) {
 		_terrainTexManager.bindTexture((size_t) it->first);
 
-		it->second.ibo->bind();
-
-		glDrawElements(GL_TRIANGLES, it->second.indices.size(), GL_UNSIGNED_INT, BUFFER_OFFSET(0));
-
-		IndexBufferObject::unbind();
+		glDrawElements(GL_TRIANGLES, it->second.indices.size(), GL_UNSIGNED_INT,
+		               BUFFER_OFFSET(it->second.offset * sizeof(GLuint)));
 
 		nbTriangles += it->second.indices.size() / 3;
 	}
 
+	IndexBufferObject::unbind();
 	Texture::unbind();
 
 	VertexArrayObject::unbind();
@@ -178,33 +329,6 @@ size_t Chunk::draw() const {
 	return nbTriangles;
 }
 
-bool Chunk::theCornersAreOutside(const glm::vec3& cam, const glm::vec3& vec) const {
-  float dots[8];
-
-  for (int i = 0 ; i < 8 ; i++) {
-    dots[i] = glm::dot(_subdivisionLevels[_currentSubdivLvl]->corners[i]-cam, vec);
-
-		if (dots[i] < 0.f)
-			return false;
-  }
-
-  return true;
-}
-
-void Chunk::computeCulling(const std::vector<glm::vec3>& planeNormals) {
-	Camera& cam = Camera::getInstance();
-  glm::vec3 pos = cam.getPos();
-
-	for (int i = 0; i < planeNormals.size(); i++) {
-		if (theCornersAreOutside(pos, planeNormals[i])) {
-			_visible = false;
-			return;
-		}
-	}
-
-  _visible = true;
-}
-
 void Chunk::computeDistanceOptimizations() {
 	Camera& camera = Camera::getInstance();
 
@@ -224,32 +348,300 @@ void Chunk::computeDistanceOptimizations() {
 	else
 		_displayMovingElements = true;
 
-	if (distanceToChunk > 10000)
-		setSubdivisionLevel(1);
-	else if (distanceToChunk > 4000)
-		setSubdivisionLevel(2);
-	else if (distanceToChunk > 1000)
-		setSubdivisionLevel(3);
+	requestForest(false);
+
+	_impostorsNeeded = _forestReceived && distanceToChunk > CHUNK_IMPOSTORS_BAKE_DIST;
+
+	if (_impostorsBaked)
+		_impostorBlend = glm::clamp((distanceToChunk - CHUNK_IMPOSTORS_START_DIST) /
+		                            (CHUNK_IMPOSTORS_END_DIST - CHUNK_IMPOSTORS_START_DIST), 0.f, 1.f);
 	else
-		setSubdivisionLevel(4);
+		_impostorBlend = 0.f;
+
+	float pixelsPerUnit = getPixelsPerUnit(camera.getPos());
+
+	_targetSubdivLvl = selectSubdivisionLevel(pixelsPerUnit);
+	setSubdivisionLevel(_targetSubdivLvl);
+
+	// The vertices move from the coarser level to the current one while the error of the coarser
+	// level goes from the maximum error to twice the maximum error. The hysteresis ensures that
+	// it is back to 0 before the coarser level is displayed again.
+	if (_currentSubdivLvl > 1) {
+		float coarserError = getGeometricError(_currentSubdivLvl - 1) * pixelsPerUnit;
+		_morphFactor = glm::clamp(coarserError / CHUNK_MAX_SCREEN_ERROR - 1.f, 0.f, 1.f);
+	}
+	else
+		_morphFactor = 1.f;
+}
+
+float Chunk::getPixelsPerUnit(glm::vec3 viewPos) const {
+	Camera& camera = Camera::getInstance();
+
+	// From the distance to the closest point of the chunk
+	glm::vec3 closestPoint = _boundingBoxMin.x <= _boundingBoxMax.x ?
+		glm::clamp(viewPos, _boundingBoxMin, _boundingBoxMax) : _centerOfChunk;
+	float distanceToBox = std::max(1.f, glm::length(viewPos - closestPoint));
+
+	return camera.getH() / (2.f * std::tan(camera.getFov() / 2.f * RAD)) / distanceToBox;
 }
 
-void Chunk::setTreesHeight(size_t subdivLvl) {
-	for (int i = 0; i < _trees.size(); i++) {
-		_trees[i]->setHeight(getHeight(_trees[i]->getPos(), subdivLvl));
+size_t Chunk::selectSubdivisionLevel(float pixelsPerUnit) const {
+	for (size_t i = 1; i < MAX_SUBDIV_LVL; i++) {
+		float maxError = i < _targetSubdivLvl ? CHUNK_LOD_HYSTERESIS * CHUNK_MAX_SCREEN_ERROR : CHUNK_MAX_SCREEN_ERROR;
+
+		if (getGeometricError(i) * pixelsPerUnit <= maxError)
+			return i;
 	}
+
+	return MAX_SUBDIV_LVL;
+}
+
+size_t Chunk::getPredictedSubdivisionLevel(glm::vec3 viewPos) const {
+	return selectSubdivisionLevel(getPixelsPerUnit(viewPos));
 }
 
-void Chunk::generateSubdivisionLevel(size_t subdivLvl) {
-	fillBufferData(subdivLvl);
-	computeChunkBoundingBox(subdivLvl);
-	setTreesHeight(subdivLvl);
+size_t Chunk::prefetchSubdivisionLevel(size_t subdivLvl) {
+	size_t nbNewLevels = 0;
+
+	requestForest(true);
+
+	if (subdivLvl > _maxSubdivLvlAsked) {
+		nbNewLevels = subdivLvl - _maxSubdivLvlAsked;
+
+		for (size_t i = _maxSubdivLvlAsked + 1; i <= subdivLvl; i++) {
+			_chunkSubdivider.addTask(this, i, true);
+		}
+
+		_maxSubdivLvlAsked = subdivLvl;
+		_hasPrefetchTasks = true;
+	}
+
+	// Only the predicted level is uploaded, the intermediate ones are skipped if the camera moves fast
+	Buffers* buffers = _subdivisionLevels[subdivLvl].get();
+
+	if (subdivLvl > 1 && !buffers->demanded) {
+		buffers->prefetched = true;
+		// Not to be evicted before the camera arrives
+		buffers->lastUsedFrame = _lodCache.getCurrentFrame();
+
+		if (subdivLvl <= _maxSubdivLvlAvailable && !buffers->generated)
+			_uploadScheduler.requestUpload(this, subdivLvl, true);
+	}
+
+	return nbNewLevels;
+}
+
+float Chunk::getGeometricError(size_t subdivLvl) const {
+	float error = 0.f;
+	float deviation = 2.f * CHUNK_DEFAULT_LEVEL_DEVIATION;
+
+	for (size_t i = 2; i <= MAX_SUBDIV_LVL; i++) {
+		// The unknown deviations are extrapolated from the previous ones
+		deviation = _levelDeviations[i] >= 0 ? _levelDeviations[i] : deviation / 2.f;
+
+		if (i > subdivLvl)
+			error += deviation;
+	}
+
+	return error;
+}
+
+void Chunk::requestForest(bool prefetch) {
+	if (!_forestAsked) {
+		_chunkSubdivider.addForestTask(this, prefetch);
+		_forestAsked = true;
+		_hasPrefetchTasks = _hasPrefetchTasks || prefetch;
+	}
+
+	// The chunk is needed now
+	else if (!prefetch && _hasPrefetchTasks) {
+		_chunkSubdivider.promoteTasks(this);
+		_hasPrefetchTasks = false;
+	}
+}
+
+void Chunk::setTrees(std::vector<igElement*> trees) {
+	size_t cpuBefore = getCPUMemory();
+	size_t gpuBefore = getGPUMemory();
+
+	_forestAsked = true;
+	_forestReceived = true;
+	_trees = trees;
+	_maxContentHeight = CHUNK_MIN_CONTENT_HEIGHT;
+
+	for (size_t i = 0; i < _trees.size(); i++) {
+		_maxContentHeight = std::max(_maxContentHeight, _trees[i]->getSize().y);
+	}
+
+	// The sprites are uploaded once, at the height of the base level
+	for (size_t i = 0; i < _trees.size(); i++) {
+		_trees[i]->setHeight(getHeight(_trees[i]->getPos(), 1));
+	}
+
+	_treeDrawer.prepareElements(_trees);
+	_treeDrawer.uploadElements(true);
+
+	// The other levels already received only need their heights
+	for (size_t i = 2; i <= _maxSubdivLvlAvailable; i++) {
+		if (_subdivisionLevels[i]->received) {
+			computeTreeHeightOffsets(i);
+
+			if (_subdivisionLevels[i]->generated)
+				uploadTreeHeightOffsets(i);
+		}
+	}
+
+	reportMemoryChange(cpuBefore, gpuBefore);
+}
+
+size_t Chunk::drawTrees() const {
+	const Buffers* currentBuffers = _subdivisionLevels[_currentSubdivLvl].get();
+
+	if (!currentBuffers->generated)
+		return 0;
+
+	if (currentBuffers->treesUploaded)
+		_treeDrawer.drawElements(currentBuffers->treeVao);
+	else
+		_treeDrawer.drawElements();
+
+	return _trees.size();
+}
+
+void Chunk::setImpostors(std::vector<igElement*> impostors) {
+	size_t cpuBefore = getCPUMemory();
+	size_t gpuBefore = getGPUMemory();
+
+	_impostorsBaked = true;
+	_impostors.clear();
+
+	for (size_t i = 0; i < impostors.size(); i++) {
+		_impostors.push_back(std::unique_ptr<igElement>(impostors[i]));
+	}
+
+	_impostorDrawer.loadElements(impostors, true);
+
+	reportMemoryChange(cpuBefore, gpuBefore);
+}
+
+size_t Chunk::drawImpostors() const {
+	if (!_subdivisionLevels[_currentSubdivLvl]->generated)
+		return 0;
+
+	return _impostorDrawer.drawElements();
+}
+
+void Chunk::computeTreeHeightOffsets(size_t subdivLvl) {
+	std::vector<float>& offsets = _subdivisionLevels[subdivLvl]->treeHeightOffsets;
+	offsets.resize(_trees.size());
+
+	for (size_t i = 0; i < _trees.size(); i++) {
+		offsets[i] = getHeight(_trees[i]->getPos(), subdivLvl) - _trees[i]->getHeight();
+	}
+}
+
+void Chunk::uploadTreeHeightOffsets(size_t subdivLvl) {
+	Buffers* currentBuffers = _subdivisionLevels[subdivLvl].get();
+
+	if (currentBuffers->treeHeightOffsets.size() == 0)
+		return;
+
+	// The same offset for the 4 vertices of each sprite
+	std::vector<float> vertexOffsets(4 * currentBuffers->treeHeightOffsets.size());
+
+	for (size_t i = 0; i < vertexOffsets.size(); i++) {
+		vertexOffsets[i] = currentBuffers->treeHeightOffsets[i/4];
+	}
+
+	currentBuffers->treeHeightOffsetsVbo.bind();
+	glBufferData(GL_ARRAY_BUFFER, vertexOffsets.size() * sizeof(float), &vertexOffsets[0], GL_STATIC_DRAW);
+	VertexBufferObject::unbind();
+
+	_treeDrawer.setupVertexArray(currentBuffers->treeVao, currentBuffers->treeHeightOffsetsVbo);
+
+	currentBuffers->gpuMemory += vertexOffsets.size() * sizeof(float);
+	currentBuffers->treesUploaded = true;
+	std::vector<float>().swap(currentBuffers->treeHeightOffsets);
+}
+
+std::unique_ptr<SubdivisionResult> Chunk::generateSubdivisionLevel(size_t subdivLvl, float skirtDepth) const {
+	std::unique_ptr<SubdivisionResult> result(new SubdivisionResult());
+	result->subdivLvl = subdivLvl;
+
+	fillBufferData(*result, skirtDepth);
+	computeBoundingBox(*result);
+	fillUploadPacket(*result);
+
+	// The trees themselves are only modified by the main thread
+	result->treesHeight.resize(_trees.size());
+
+	for (size_t i = 0; i < _trees.size(); i++) {
+		result->treesHeight[i] = getHeight(_trees[i]->getPos(), subdivLvl);
+	}
+
+	return result;
+}
+
+void Chunk::applySubdivisionLevel(SubdivisionResult& result) {
+	size_t subdivLvl = result.subdivLvl;
+	Buffers* currentBuffers = _subdivisionLevels[subdivLvl].get();
+	size_t cpuBefore = getCPUMemory();
+	size_t gpuBefore = getGPUMemory();
+
+	currentBuffers->vertices    = std::move(result.vertices);
+	currentBuffers->vertexData  = std::move(result.vertexData);
+	currentBuffers->indexData   = std::move(result.indexData);
+	currentBuffers->indicesInfo = std::move(result.indicesInfo);
+
+	// The box is extended and never shrunk so that it stays conservative over all the LODs
+	_boundingBoxMin = glm::min(_boundingBoxMin, result.boundingBoxMin);
+	_boundingBoxMax = glm::max(_boundingBoxMax, result.boundingBoxMax);
+
+	_centerOfChunk = glm::vec3((_chunkPos.x+0.5)*CHUNK_SIZE, (_chunkPos.y+0.5)*CHUNK_SIZE, result.centerHeight);
+
+	if (result.deviation >= 0)
+		_levelDeviations[subdivLvl] = result.deviation;
+
+	// The trees may have been set after the task was added
+	if (subdivLvl > 1) {
+		if (result.treesHeight.size() == _trees.size()) {
+			currentBuffers->treeHeightOffsets.resize(_trees.size());
+
+			for (size_t i = 0; i < _trees.size(); i++) {
+				currentBuffers->treeHeightOffsets[i] = result.treesHeight[i] - _trees[i]->getHeight();
+			}
+		}
+
+		else
+			computeTreeHeightOffsets(subdivLvl);
+	}
+
+	currentBuffers->received = true;
+	reportMemoryChange(cpuBefore, gpuBefore);
 
 	if (_maxSubdivLvlAvailable < subdivLvl)
 		_maxSubdivLvlAvailable = subdivLvl;
+
+	// The base level is always needed, it is the fallback of the other ones
+	if (subdivLvl == 1)
+		_uploadScheduler.requestUpload(this, 1);
+
+	else if (currentBuffers->prefetched && !currentBuffers->demanded)
+		_uploadScheduler.requestUpload(this, subdivLvl, true);
+}
+
+float Chunk::getSkirtDepth() const {
+	// The gap between two levels is at most the error of the coarsest one
+	return std::max(CHUNK_MIN_SKIRT_DEPTH, getGeometricError(1));
 }
 
 void Chunk::setSubdivisionLevel(size_t newSubdLvl) {
+	// The prefetched levels are needed now
+	if (_hasPrefetchTasks && newSubdLvl > _maxSubdivLvlAvailable) {
+		_chunkSubdivider.promoteTasks(this);
+		_hasPrefetchTasks = false;
+	}
+
 	if (newSubdLvl > _maxSubdivLvlAsked) {
 		for (int i = _maxSubdivLvlAsked + 1; i <= newSubdLvl; i++) {
 			_chunkSubdivider.addTask(this, i);
@@ -258,16 +650,123 @@ void Chunk::setSubdivisionLevel(size_t newSubdLvl) {
 		_maxSubdivLvlAsked = newSubdLvl;
 	}
 
-	if (newSubdLvl > _maxSubdivLvlAvailable)
-		_currentSubdivLvl = _maxSubdivLvlAvailable;
+	size_t displayedLvl = std::min(newSubdLvl, _maxSubdivLvlAvailable);
 
-	else
-		_currentSubdivLvl = newSubdLvl;
+	if (!_subdivisionLevels[displayedLvl]->generated) {
+		_uploadScheduler.requestUpload(this, displayedLvl);
+
+		// Until the upload is done, the closest uploaded level is displayed, a finer one if possible
+		size_t closestLvl = displayedLvl;
+
+		for (size_t i = displayedLvl + 1; i <= _maxSubdivLvlAvailable && closestLvl == displayedLvl; i++) {
+			if (_subdivisionLevels[i]->generated)
+				closestLvl = i;
+		}
+
+		for (size_t i = displayedLvl - 1; i >= 1 && closestLvl == displayedLvl; i--) {
+			if (_subdivisionLevels[i]->generated)
+				closestLvl = i;
+		}
+
+		displayedLvl = closestLvl;
+	}
+
+	_currentSubdivLvl = displayedLvl;
+	_subdivisionLevels[_currentSubdivLvl]->lastUsedFrame = _lodCache.getCurrentFrame();
+
+	// The first time a level is needed, the prefetch is a hit if a prefetched level at least as fine is displayed
+	Buffers* newBuffers = _subdivisionLevels[newSubdLvl].get();
+
+	if (newSubdLvl > 1 && !newBuffers->demanded) {
+		newBuffers->demanded = true;
+
+		if (_currentSubdivLvl >= newSubdLvl && _subdivisionLevels[_currentSubdivLvl]->prefetched)
+			_nbPrefetchHits++;
+		else
+			_nbPrefetchMisses++;
+	}
+}
+
+size_t Chunk::uploadSubdivisionLevel(size_t subdivLvl) {
+	// The level may have been evicted since the request
+	if (subdivLvl > _maxSubdivLvlAvailable)
+		return 0;
+
+	Buffers* currentBuffers = _subdivisionLevels[subdivLvl].get();
+
+	// The base level is available from the start but may not be received yet, it asks its upload itself
+	if (currentBuffers->generated || !currentBuffers->received)
+		return 0;
+
+	size_t cpuBefore = getCPUMemory();
+	size_t gpuBefore = getGPUMemory();
+
+	generateBuffers(subdivLvl);
+	uploadTreeHeightOffsets(subdivLvl);
+	reportMemoryChange(cpuBefore, gpuBefore);
 
-	if (!_subdivisionLevels[_currentSubdivLvl]->generated) {
-		generateBuffers();
-		_subdivisionLevels[_currentSubdivLvl]->treeDrawer.loadElements(_trees, true);
+	if (currentBuffers->evicted) {
+		currentBuffers->evicted = false;
+		_lodCache.notifyRegeneration();
 	}
+
+	return currentBuffers->gpuMemory;
+}
+
+size_t Chunk::getUploadSize(size_t subdivLvl) const {
+	const Buffers* currentBuffers = _subdivisionLevels[subdivLvl].get();
+
+	return currentBuffers->vertexData.size() * sizeof(float) +
+	       currentBuffers->indexData.size() * sizeof(GLuint) +
+	       currentBuffers->treeHeightOffsets.size() * 4 * sizeof(float);
+}
+
+size_t Chunk::getCPUMemory() const {
+	size_t res = 0;
+
+	for (size_t i = 0; i < _subdivisionLevels.size(); i++) {
+		res += _subdivisionLevels[i]->getCPUMemory();
+	}
+
+	return res + _treeDrawer.getCPUMemory() + _impostorDrawer.getCPUMemory();
+}
+
+size_t Chunk::getGPUMemory() const {
+	size_t res = 0;
+
+	for (size_t i = 0; i < _subdivisionLevels.size(); i++) {
+		res += _subdivisionLevels[i]->gpuMemory;
+	}
+
+	return res + _treeDrawer.getGPUMemory() + _impostorDrawer.getGPUMemory();
+}
+
+void Chunk::reportMemoryChange(size_t cpuBefore, size_t gpuBefore) {
+	_lodCache.updateMemory(cpuBefore, getCPUMemory(), gpuBefore, getGPUMemory());
+}
+
+bool Chunk::canEvictFinestLevel() const {
+	// Level 1 is the base level, it is always kept
+	return _maxSubdivLvlAvailable > 1 &&
+	       _maxSubdivLvlAvailable > _currentSubdivLvl &&
+	       _maxSubdivLvlAsked == _maxSubdivLvlAvailable;
+}
+
+void Chunk::evictFinestLevel() {
+	if (!canEvictFinestLevel())
+		return;
+
+	size_t cpuBefore = getCPUMemory();
+	size_t gpuBefore = getGPUMemory();
+
+	_subdivisionLevels[_maxSubdivLvlAvailable].reset(new Buffers());
+	_subdivisionLevels[_maxSubdivLvlAvailable]->evicted = true;
+
+	// The level will be asked to the subdivider again when needed
+	_maxSubdivLvlAvailable--;
+	_maxSubdivLvlAsked--;
+
+	reportMemoryChange(cpuBefore, gpuBefore);
 }
 
 float Chunk::getHeight(glm::vec2 pos) const {
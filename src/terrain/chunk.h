@@ -1,5 +1,6 @@
 #pragma once
 
+#include <array>
 #include <map>
 #include <stddef.h> // size_t
 #include <vector>
@@ -7,80 +8,212 @@
 #include "basicGLObjects.h"
 #include "terrainGeometry.h"
 #include "terrainTexManager.h"
+#include "chunkLodCache.h"
 #include "chunkSubdivider.h"
+#include "chunkUploadScheduler.h"
 #include "igElementDisplay.h"
 
 struct BiomeIndices {
 	std::vector<GLuint> indices;
-	std::unique_ptr<IndexBufferObject> ibo;
+	size_t offset = 0; // Position of the first index in the index buffer of the level
 };
 
 struct Buffers {
-	bool generated = false;
+	bool received = false; // Received from the subdivider
+	bool generated = false; // Uploaded to the GPU
+	bool evicted = false; // The level has been evicted by the LOD cache and will be regenerated
+	bool prefetched = false; // Asked by the prefetcher before the chunk needed it
+	bool demanded = false; // Needed by the chunk at least once
+	size_t lastUsedFrame = 0;
+	size_t gpuMemory = 0; // In bytes, computed when the buffers are uploaded
 	VertexArrayObject vao;
 	VertexBufferObject vbo;
+	IndexBufferObject ibo;
 
 	std::vector<float> vertices;
-	std::vector<float> normals;
-	std::vector<float> coords;
 
-	glm::vec3 corners[8]; // For frustum culling
+	// Prepared by the subdivider so that the upload is a single copy per buffer, released once uploaded
+	std::vector<float> vertexData;
+	std::vector<GLuint> indexData;
+
+	// The trees of the chunk are shared by all the levels, each level only adds its heights
+	// to the ones of the base level. Not used by the base level
+	VertexArrayObject treeVao;
+	VertexBufferObject treeHeightOffsetsVbo;
+	std::vector<float> treeHeightOffsets; // One per tree, released once uploaded
+	bool treesUploaded = false;
+
+	std::map<Biome, BiomeIndices> indicesInfo;
+
+	size_t getCPUMemory() const;
+};
+
+class Chunk;
 
-	igElementDisplay treeDrawer;
+// Subdivision level generated by the ChunkSubdivider thread. It does not contain
+// any OpenGL object and is moved into the chunk by the main thread
+struct SubdivisionResult {
+	Chunk* chunk;
+	size_t subdivLvl;
 
+	std::vector<float> vertices;
+	// Only used to fill vertexData
+	std::vector<float> normals;
+	std::vector<float> coords;
+	std::vector<float> coarseHeights; // Height of each vertex on the coarser level, for geomorphing
+
+	std::vector<float> vertexData;
+	std::vector<GLuint> indexData;
 	std::map<Biome, BiomeIndices> indicesInfo;
+
+	glm::vec3 boundingBoxMin;
+	glm::vec3 boundingBoxMax;
+	float centerHeight;
+	float deviation; // Height difference with the coarser level, negative for the first level
+	std::vector<float> treesHeight;
 };
 
 class Chunk {
 public:
 	Chunk(size_t x, size_t y, const TerrainTexManager& terrainTexManager,
 		                              TerrainGeometry& terrainGeometry,
-																	ChunkSubdivider& chunkSubdivider);
+																	ChunkSubdivider& chunkSubdivider,
+																	ChunkLodCache& lodCache,
+																	ChunkUploadScheduler& uploadScheduler);
 
 	size_t draw() const;
 
-	// Set visible to false if there is no need to display the chunk
-	void computeCulling(const std::vector<glm::vec3>& planeNormals);
 	void computeDistanceOptimizations();
+	// Level that would be chosen if the camera was at viewPos
+	size_t getPredictedSubdivisionLevel(glm::vec3 viewPos) const;
+	// Generates and uploads the levels up to subdivLvl with a low priority
+	// Returns the number of levels newly asked to the subdivider
+	size_t prefetchSubdivisionLevel(size_t subdivLvl);
+	// A level is a hit if it was prefetched and uploaded when the chunk needed it for the first time
+	inline size_t getNbPrefetchHits() const {return _nbPrefetchHits;}
+	inline size_t getNbPrefetchMisses() const {return _nbPrefetchMisses;}
 
 	float getHeight(glm::vec2 pos) const;
 	glm::vec3 getNorm(glm::vec2 pos) const;
 	inline bool isVisible() const {return _visible;}
+	inline void setVisible(bool visible) {_visible = visible;}
+	// The content of the chunk is made of its trees and moving elements
+	inline bool isTerrainOccluded() const {return _terrainOccluded;}
+	inline bool isContentOccluded() const {return _contentOccluded;}
+	inline void setOcclusion(bool terrainOccluded, bool contentOccluded) {
+		_terrainOccluded = terrainOccluded; _contentOccluded = contentOccluded;}
 	inline bool getTreesNeedTwoPasses() const {return _treesNeedTwoPasses;}
 	inline bool getDisplayMovingElements() const {return _displayMovingElements;}
 	size_t getSubdivisionLevel() const {return _currentSubdivLvl;}
-
-	inline void setTrees(std::vector<igElement*> trees) {_trees = trees; setTreesHeight(_currentSubdivLvl);}
-	inline size_t drawTrees() const {_subdivisionLevels[_currentSubdivLvl]->treeDrawer.drawElements(); return _trees.size();}
-
-	friend ChunkSubdivider;
+	// Between 0 (coarser level shape) and 1 (current level shape)
+	inline float getMorphFactor() const {return _morphFactor;}
+	inline glm::ivec2 getChunkPos() const {return _chunkPos;}
+	inline glm::vec3 getCenter() const {return _centerOfChunk;}
+	// Bounding box containing the chunk at every subdivision level that has been generated
+	// It is empty (min > max) as long as no level contains any vertex
+	inline glm::vec3 getBoundingBoxMin() const {return _boundingBoxMin;}
+	inline glm::vec3 getBoundingBoxMax() const {return _boundingBoxMax;}
+	inline glm::vec3 getContentBoundingBoxMax() const {return _boundingBoxMax + glm::vec3(0,0,_maxContentHeight);}
+	// The chunk can be displayed once its base level is received from the subdivider
+	inline bool isBaseLevelReceived() const {return _subdivisionLevels[1]->received;}
+	// The subdivider is generating a level of the chunk or will do so
+	inline bool hasPendingSubdivision() const {
+		return !isBaseLevelReceived() || _maxSubdivLvlAsked > _maxSubdivLvlAvailable;}
+	// Coarsest level, used as an occluder. nullptr if it is not generated yet
+	inline const Buffers* getOccluderBuffers() const {
+		return _subdivisionLevels[1]->generated ? _subdivisionLevels[1].get() : nullptr;}
+
+	// Memory used by all the generated subdivision levels, in bytes
+	size_t getCPUMemory() const;
+	size_t getGPUMemory() const;
+
+	// The finest level can be evicted if it is not displayed and not being generated
+	bool canEvictFinestLevel() const;
+	inline size_t getFinestLevelLastUse() const {return _subdivisionLevels[_maxSubdivLvlAvailable]->lastUsedFrame;}
+	void evictFinestLevel();
+
+	// Sends the buffers of a generated level to the GPU, returns the number of bytes uploaded
+	size_t uploadSubdivisionLevel(size_t subdivLvl);
+	size_t getUploadSize(size_t subdivLvl) const;
+
+	// The forests are generated by the subdivider the first time the chunk is needed
+	void requestForest(bool prefetch);
+	inline bool isForestReceived() const {return _forestReceived;}
+	void setTrees(std::vector<igElement*> trees);
+	inline const std::vector<igElement*>& getTrees() const {return _trees;}
+	size_t drawTrees() const;
+
+	// The trees of the distant chunks are replaced by impostors baked by the ForestImpostorBaker
+	inline bool needsImpostors() const {return _impostorsNeeded && !_impostorsBaked;}
+	void setImpostors(std::vector<igElement*> impostors);
+	// Between 0 (only the trees are displayed) and 1 (only the impostors)
+	inline float getImpostorBlend() const {return _impostorBlend;}
+	size_t drawImpostors() const;
+
+	// Called from the ChunkSubdivider thread, only reads data that does not change after the initialization
+	std::unique_ptr<SubdivisionResult> generateSubdivisionLevel(size_t subdivLvl, float skirtDepth) const;
+	// Called from the main thread
+	void applySubdivisionLevel(SubdivisionResult& result);
+	// Depth of the skirts of the next levels generated
+	float getSkirtDepth() const;
 
 private:
 	void cleanSubdivLvl(size_t subdivLvl);
-	void fillBufferData(size_t subdivLvl);
-	void generateBuffers();
-	void computeChunkBoundingBox(size_t subdivLvl);
-	bool theCornersAreOutside(const glm::vec3& cam, const glm::vec3& vec) const;
-	void setTreesHeight(size_t subdivLvl);
-	void generateSubdivisionLevel(size_t level);
+	void fillBufferData(SubdivisionResult& result, float skirtDepth) const;
+	// Adds vertical strips under the borders of the chunk to hide the cracks between levels
+	void addSkirts(SubdivisionResult& result, const std::list<const Triangle*>& triangles,
+	               const std::map<Vertex*, size_t>& verticesArrayIndices, float skirtDepth) const;
+	void fillUploadPacket(SubdivisionResult& result) const;
+	void computeBoundingBox(SubdivisionResult& result) const;
+	void generateBuffers(size_t subdivLvl);
+	void computeTreeHeightOffsets(size_t subdivLvl);
+	void uploadTreeHeightOffsets(size_t subdivLvl);
 	void setSubdivisionLevel(size_t newSubdLvl);
+	// Passes to the LOD cache the memory change since cpuBefore and gpuBefore were measured
+	void reportMemoryChange(size_t cpuBefore, size_t gpuBefore);
 
 	float getHeight(glm::vec2 pos, size_t subdivLvl) const;
+	float getPixelsPerUnit(glm::vec3 viewPos) const;
+	size_t selectSubdivisionLevel(float pixelsPerUnit) const;
+	// Maximum height difference between the level and the finest one, in world units
+	float getGeometricError(size_t subdivLvl) const;
 
 	glm::ivec2 _chunkPos;
 	glm::vec3 _centerOfChunk;
+	glm::vec3 _boundingBoxMin;
+	glm::vec3 _boundingBoxMax;
 
 	bool _visible;
+	bool _terrainOccluded;
+	bool _contentOccluded;
 	bool _treesNeedTwoPasses;
 	bool _displayMovingElements;
 	size_t _currentSubdivLvl;
 	size_t _maxSubdivLvlAvailable;
 	size_t _maxSubdivLvlAsked;
+	size_t _targetSubdivLvl; // Level chosen by the screen space error, may not be available yet
+	float _morphFactor;
+	bool _hasPrefetchTasks; // Some levels asked to the subdivider are prefetch tasks
+	size_t _nbPrefetchHits;
+	size_t _nbPrefetchMisses;
+	// Height difference between each level and the previous one, negative if unknown
+	std::array<float, MAX_SUBDIV_LVL+1> _levelDeviations;
 	std::vector<std::unique_ptr<Buffers> > _subdivisionLevels;
 
 	const TerrainTexManager& _terrainTexManager;
 	TerrainGeometry& _terrainGeometry;
 	ChunkSubdivider& _chunkSubdivider;
-
-	std::vector<igElement*> _trees;
+	ChunkLodCache& _lodCache;
+	ChunkUploadScheduler& _uploadScheduler;
+
+	bool _forestAsked;
+	bool _forestReceived;
+	std::vector<igElement*> _trees; // Placed on the base level
+	igElementDisplay _treeDrawer;
+	bool _impostorsNeeded;
+	bool _impostorsBaked;
+	float _impostorBlend;
+	std::vector<std::unique_ptr<igElement> > _impostors;
+	igElementDisplay _impostorDrawer;
+	float _maxContentHeight; // Height of the highest element standing on the chunk
 };
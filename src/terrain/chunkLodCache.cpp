@@ -0,0 +1,62 @@
+#include "chunkLodCache.h"
+
+#include "camera.h"
+#include "chunk.h"
+
+#include <algorithm>
+
+// Chunks closer than this distance to the camera never lose their LODs
+#define LOD_EVICTION_MIN_DISTANCE 2000.f
+
+ChunkLodCache::ChunkLodCache(size_t cpuBudget, size_t gpuBudget) :
+  _cpuBudget(cpuBudget),
+  _gpuBudget(gpuBudget),
+  _currentFrame(0),
+  _cpuMemory(0),
+  _gpuMemory(0),
+  _nbEvictions(0),
+  _nbRegenerations(0) {}
+
+void ChunkLodCache::enforceBudgets(const std::vector<std::unique_ptr<Chunk> >& terrain) {
+  if (!isOverBudget())
+    return;
+
+  Camera& cam = Camera::getInstance();
+  _candidates.clear();
+
+  for (size_t i = 0; i < terrain.size(); i++) {
+    Chunk* chunk = terrain[i].get();
+
+    if (!chunk->canEvictFinestLevel())
+      continue;
+
+    float distance = glm::length(cam.getPos() - chunk->getCenter());
+
+    if (distance >= LOD_EVICTION_MIN_DISTANCE)
+      _candidates.push_back(EvictionCandidate{chunk, chunk->getFinestLevelLastUse(), distance});
+  }
+
+  // Only the candidates actually evicted are sorted
+  std::make_heap(_candidates.begin(), _candidates.end(), evictedAfter);
+
+  while (isOverBudget() && !_candidates.empty()) {
+    std::pop_heap(_candidates.begin(), _candidates.end(), evictedAfter);
+    EvictionCandidate candidate = _candidates.back();
+    _candidates.pop_back();
+
+    candidate.chunk->evictFinestLevel();
+    _nbEvictions++;
+
+    // Its next level competes with the other chunks
+    if (candidate.chunk->canEvictFinestLevel()) {
+      candidate.lastUse = candidate.chunk->getFinestLevelLastUse();
+      _candidates.push_back(candidate);
+      std::push_heap(_candidates.begin(), _candidates.end(), evictedAfter);
+    }
+  }
+}
+
+bool ChunkLodCache::evictedAfter(const EvictionCandidate& a, const EvictionCandidate& b) {
+  // The least recently used finest LOD is evicted first, the farthest chunk breaks the ties
+  return a.lastUse > b.lastUse || (a.lastUse == b.lastUse && a.distance < b.distance);
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <memory>
+#include <stddef.h> // size_t
+#include <vector>
+
+class Chunk;
+
+// Default memory budgets for the chunk LODs, in bytes
+#define LOD_CPU_MEMORY_BUDGET (192*1024*1024)
+#define LOD_GPU_MEMORY_BUDGET (192*1024*1024)
+
+/** Keeps the memory used by the subdivision levels of the chunks under a budget.
+  * The finest LODs of the chunks far from the camera are evicted in least
+  * recently used order. They are regenerated from the terrain geometry when
+  * the chunk comes back into range.
+  */
+class ChunkLodCache {
+public:
+  ChunkLodCache(size_t cpuBudget = LOD_CPU_MEMORY_BUDGET, size_t gpuBudget = LOD_GPU_MEMORY_BUDGET);
+
+  inline void setBudgets(size_t cpuBudget, size_t gpuBudget) {_cpuBudget = cpuBudget; _gpuBudget = gpuBudget;}
+
+  // Called once per frame, before the chunks are updated
+  inline void newFrame() {_currentFrame++;}
+  // Evicts LODs until the memory used fits in the budgets
+  void enforceBudgets(const std::vector<std::unique_ptr<Chunk> >& terrain);
+  // Called by the chunks each time the memory of their LODs changes, the totals are never recomputed
+  inline void updateMemory(size_t cpuBefore, size_t cpuAfter, size_t gpuBefore, size_t gpuAfter) {
+    _cpuMemory = _cpuMemory - cpuBefore + cpuAfter;
+    _gpuMemory = _gpuMemory - gpuBefore + gpuAfter;
+  }
+
+  inline void notifyRegeneration() {_nbRegenerations++;}
+
+  inline size_t getCurrentFrame() const {return _currentFrame;}
+  inline size_t getCPUMemory() const {return _cpuMemory;}
+  inline size_t getGPUMemory() const {return _gpuMemory;}
+  inline size_t getNbEvictions() const {return _nbEvictions;}
+  inline size_t getNbRegenerations() const {return _nbRegenerations;}
+
+private:
+  struct EvictionCandidate {
+    Chunk* chunk;
+    size_t lastUse; // Of its finest level
+    float distance;
+  };
+
+  inline bool isOverBudget() const {return _cpuMemory > _cpuBudget || _gpuMemory > _gpuBudget;}
+  // Order of the heap of candidates
+  static bool evictedAfter(const EvictionCandidate& a, const EvictionCandidate& b);
+
+  size_t _cpuBudget;
+  size_t _gpuBudget;
+
+  size_t _currentFrame;
+  size_t _cpuMemory;
+  size_t _gpuMemory;
+
+  size_t _nbEvictions;
+  size_t _nbRegenerations;
+
+  // Heap whose top is the next LOD to evict
+  std::vector<EvictionCandidate> _candidates;
+};
@@ -0,0 +1,123 @@
+#include "chunkPrefetcher.h"
+
+#include <algorithm>
+
+#include "camera.h"
+#include "chunk.h"
+#include "utils.h"
+
+ChunkPrefetcher::ChunkPrefetcher() :
+  _enabled(true),
+  _hasPreviousPos(false),
+  _previousPointedPos(0.f),
+  _previousZoom(0.f),
+  _velocity(0.f),
+  _zoomVelocity(0.f),
+  _jumpTarget(0.f),
+  _msSinceJumpTarget(PREFETCH_JUMP_TARGET_MS),
+  _nbLevelsPrefetched(0),
+  _hitRate(0.f) {}
+
+void ChunkPrefetcher::setJumpTarget(glm::vec2 target) {
+  _jumpTarget = target;
+  _msSinceJumpTarget = 0;
+}
+
+void ChunkPrefetcher::update(int msElapsed, const std::vector<std::unique_ptr<Chunk> >& terrain) {
+  updateVelocity(msElapsed);
+  updateHitRate(terrain);
+
+  if (!_enabled)
+    return;
+
+  Camera& cam = Camera::getInstance();
+
+  glm::vec2 predictedPos = cam.getPointedPos() + _velocity * PREFETCH_HORIZON_MS;
+  predictedPos = glm::clamp(predictedPos, glm::vec2(0.f), glm::vec2(MAX_COORD - 1));
+
+  float predictedZoom = cam.getZoom() + _zoomVelocity * PREFETCH_HORIZON_MS;
+  predictedZoom = std::max(MIN_R, std::min(MAX_R, predictedZoom));
+
+  // The height of the terrain is not known before the levels are generated, the current one is kept
+  prefetchFrom(predictedPos, cam.getHeight(), predictedZoom, terrain);
+
+  if (_msSinceJumpTarget < PREFETCH_JUMP_TARGET_MS) {
+    _msSinceJumpTarget += msElapsed;
+
+    glm::uvec2 chunkPos = ut::convertToChunkCoords(_jumpTarget);
+    float targetHeight = terrain[chunkPos.x*NB_CHUNKS + chunkPos.y]->getCenter().z;
+
+    prefetchFrom(_jumpTarget, targetHeight, cam.getZoom(), terrain);
+  }
+}
+
+void ChunkPrefetcher::updateVelocity(int msElapsed) {
+  Camera& cam = Camera::getInstance();
+
+  if (msElapsed <= 0)
+    return;
+
+  if (!_hasPreviousPos) {
+    _hasPreviousPos = true;
+    _previousPointedPos = cam.getPointedPos();
+    _previousZoom = cam.getZoom();
+    return;
+  }
+
+  glm::vec2 displacement = cam.getPointedPos() - _previousPointedPos;
+
+  // A jump says nothing about the next positions
+  if (glm::length(displacement) > PREFETCH_JUMP_DIST) {
+    _velocity = glm::vec2(0.f);
+    _zoomVelocity = 0.f;
+  }
+
+  else {
+    _velocity = glm::mix(_velocity, displacement / (float) msElapsed, PREFETCH_VELOCITY_SMOOTHING);
+    _zoomVelocity = glm::mix(_zoomVelocity, (cam.getZoom() - _previousZoom) / msElapsed, PREFETCH_VELOCITY_SMOOTHING);
+  }
+
+  _previousPointedPos = cam.getPointedPos();
+  _previousZoom = cam.getZoom();
+}
+
+void ChunkPrefetcher::prefetchFrom(glm::vec2 pointedPos, float pointedHeight, float zoom,
+                                   const std::vector<std::unique_ptr<Chunk> >& terrain) {
+  Camera& cam = Camera::getInstance();
+
+  glm::vec3 target(pointedPos, pointedHeight + cam.getAdditionalHeight());
+  glm::vec3 viewPos = target + ut::carthesian(zoom, cam.getTheta(), cam.getPhi());
+  glm::vec3 viewDir = glm::normalize(target - viewPos);
+
+  for (size_t i = 0; i < terrain.size(); i++) {
+    glm::vec3 boxMin = terrain[i]->getBoundingBoxMin();
+    glm::vec3 boxMax = terrain[i]->getBoundingBoxMax();
+
+    if (boxMin.x > boxMax.x)
+      continue;
+
+    // Only the chunks in front of the predicted camera, the frustum itself depends on the angles
+    glm::vec3 center = (boxMin + boxMax) / 2.f;
+    glm::vec3 halfSize = (boxMax - boxMin) / 2.f;
+
+    if (glm::dot(center - viewPos, viewDir) + glm::dot(halfSize, glm::abs(viewDir)) < 0)
+      continue;
+
+    size_t predictedLvl = terrain[i]->getPredictedSubdivisionLevel(viewPos);
+
+    if (predictedLvl > terrain[i]->getSubdivisionLevel())
+      _nbLevelsPrefetched += terrain[i]->prefetchSubdivisionLevel(predictedLvl);
+  }
+}
+
+void ChunkPrefetcher::updateHitRate(const std::vector<std::unique_ptr<Chunk> >& terrain) {
+  size_t nbHits = 0;
+  size_t nbMisses = 0;
+
+  for (size_t i = 0; i < terrain.size(); i++) {
+    nbHits += terrain[i]->getNbPrefetchHits();
+    nbMisses += terrain[i]->getNbPrefetchMisses();
+  }
+
+  _hitRate = nbHits + nbMisses > 0 ? nbHits / (float) (nbHits + nbMisses) : 0.f;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <memory>
+#include <stddef.h> // size_t
+#include <vector>
+
+class Chunk;
+
+// How far in the future the camera motion is extrapolated
+#define PREFETCH_HORIZON_MS 750.f
+// Weight of the last frame in the smoothed camera velocity
+#define PREFETCH_VELOCITY_SMOOTHING 0.2f
+// A larger displacement of the pointed position in one frame is a jump, not a motion
+#define PREFETCH_JUMP_DIST (2*CHUNK_SIZE)
+// A jump target is forgotten if it is not refreshed during this time
+#define PREFETCH_JUMP_TARGET_MS 500
+
+/** Asks the subdivision levels the chunks will need before the camera gets there.
+  * The camera velocity is extrapolated and the chunks in front of the predicted
+  * position get the level the screen space error would choose from there, as
+  * low priority subdivision and upload tasks. The position the camera may jump
+  * to, e.g. the one hovered on the minimap, is prefetched the same way.
+  */
+class ChunkPrefetcher {
+public:
+  ChunkPrefetcher();
+
+  inline void switchEnabled() {_enabled = !_enabled;}
+  // Position the camera may be moved to instantly
+  void setJumpTarget(glm::vec2 target);
+
+  // Called once per frame, after the levels needed by the current frame have been asked
+  void update(int msElapsed, const std::vector<std::unique_ptr<Chunk> >& terrain);
+
+  inline size_t getNbLevelsPrefetched() const {return _nbLevelsPrefetched;}
+  // Fraction of the levels needed by the chunks that were prefetched and ready in time
+  inline float getHitRate() const {return _hitRate;}
+
+private:
+  void updateVelocity(int msElapsed);
+  // The camera is assumed to keep its angles, pointedHeight is the height of the terrain at pointedPos
+  void prefetchFrom(glm::vec2 pointedPos, float pointedHeight, float zoom,
+                    const std::vector<std::unique_ptr<Chunk> >& terrain);
+  void updateHitRate(const std::vector<std::unique_ptr<Chunk> >& terrain);
+
+  bool _enabled;
+
+  bool _hasPreviousPos;
+  glm::vec2 _previousPointedPos;
+  float _previousZoom;
+  glm::vec2 _velocity; // Of the pointed position, in units per ms
+  float _zoomVelocity;
+
+  glm::vec2 _jumpTarget;
+  int _msSinceJumpTarget;
+
+  size_t _nbLevelsPrefetched;
+  float _hitRate;
+};
@@ -0,0 +1,251 @@
+#include "chunkQuadtree.h"
+
+#include <SDL_log.h>
+#include <algorithm>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #include <emmintrin.h>
+  #define QUADTREE_SSE
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+  #include <arm_neon.h>
+  #define QUADTREE_NEON
+#endif
+
+#include "chunk.h"
+
+ChunkQuadtree::ChunkQuadtree() :
+  _nbNodesTested(0) {
+  setPlanes(std::vector<glm::vec3>(), glm::vec3(0.f));
+}
+
+void ChunkQuadtree::build(size_t nbChunks) {
+  _nodes.clear();
+  buildNode(0, 0, nbChunks, nbChunks, nbChunks);
+}
+
+size_t ChunkQuadtree::buildNode(size_t xBegin, size_t yBegin, size_t xEnd, size_t yEnd, size_t nbChunks) {
+  size_t index = _nodes.size();
+  _nodes.push_back(Node());
+  _nodes[index].chunk = -1;
+
+  if (xEnd - xBegin == 1 && yEnd - yBegin == 1) {
+    _nodes[index].chunk = xBegin * nbChunks + yBegin;
+    return index;
+  }
+
+  size_t xMiddle = (xBegin + xEnd + 1) / 2;
+  size_t yMiddle = (yBegin + yEnd + 1) / 2;
+
+  std::array<glm::uvec4, 4> quadrants = {
+    glm::uvec4(xBegin,  yBegin,  xMiddle, yMiddle),
+    glm::uvec4(xMiddle, yBegin,  xEnd,    yMiddle),
+    glm::uvec4(xBegin,  yMiddle, xMiddle, yEnd),
+    glm::uvec4(xMiddle, yMiddle, xEnd,    yEnd)
+  };
+
+  for (int i = 0; i < 4; i++) {
+    // Non power of two sizes produce empty quadrants
+    if (quadrants[i].x < quadrants[i].z && quadrants[i].y < quadrants[i].w) {
+      size_t child = buildNode(quadrants[i].x, quadrants[i].y, quadrants[i].z, quadrants[i].w, nbChunks);
+      _nodes[index].children.push_back(child);
+    }
+  }
+
+  return index;
+}
+
+void ChunkQuadtree::refit(const std::vector<std::unique_ptr<Chunk> >& terrain) {
+  if (!_nodes.empty())
+    refitNode(0, terrain);
+}
+
+void ChunkQuadtree::refitNode(size_t node, const std::vector<std::unique_ptr<Chunk> >& terrain) {
+  Node& current = _nodes[node];
+
+  if (current.chunk >= 0) {
+    current.boxMin = terrain[current.chunk]->getBoundingBoxMin();
+    current.boxMax = terrain[current.chunk]->getBoundingBoxMax();
+    return;
+  }
+
+  current.boxMin = glm::vec3(std::numeric_limits<float>::max());
+  current.boxMax = glm::vec3(- std::numeric_limits<float>::max());
+
+  for (size_t i = 0; i < current.children.size(); i++) {
+    refitNode(current.children[i], terrain);
+    current.boxMin = glm::min(current.boxMin, _nodes[current.children[i]].boxMin);
+    current.boxMax = glm::max(current.boxMax, _nodes[current.children[i]].boxMax);
+  }
+}
+
+void ChunkQuadtree::setPlanes(const std::vector<glm::vec3>& planeNormals, glm::vec3 camPos) {
+  if (planeNormals.size() > QUADTREE_MAX_PLANES)
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Error in ChunkQuadtree::setPlanes, too many planes given");
+
+  for (size_t i = 0; i < QUADTREE_MAX_PLANES; i++) {
+    // Unused planes accept everything
+    glm::vec3 normal(0.f);
+    float d = -1.f;
+
+    if (i < planeNormals.size()) {
+      normal = planeNormals[i];
+      d = - glm::dot(normal, camPos);
+    }
+
+    _planeX[i] = normal.x;
+    _planeY[i] = normal.y;
+    _planeZ[i] = normal.z;
+    _planeD[i] = d;
+
+    _positiveX[i] = normal.x >= 0 ? 0xFFFFFFFF : 0;
+    _positiveY[i] = normal.y >= 0 ? 0xFFFFFFFF : 0;
+    _positiveZ[i] = normal.z >= 0 ? 0xFFFFFFFF : 0;
+  }
+}
+
+void ChunkQuadtree::testBox(glm::vec3 boxMin, glm::vec3 boxMax, uint32_t& outside, uint32_t& inside) const {
+  // The corner of the box closest to the inside of each plane (n-vertex) decides
+  // if the box is outside, the farthest one (p-vertex) if it is inside
+#if defined(QUADTREE_SSE)
+  __m128 minX = _mm_set1_ps(boxMin.x), maxX = _mm_set1_ps(boxMax.x);
+  __m128 minY = _mm_set1_ps(boxMin.y), maxY = _mm_set1_ps(boxMax.y);
+  __m128 minZ = _mm_set1_ps(boxMin.z), maxZ = _mm_set1_ps(boxMax.z);
+
+  __m128 posX = _mm_castsi128_ps(_mm_load_si128((const __m128i*) _positiveX));
+  __m128 posY = _mm_castsi128_ps(_mm_load_si128((const __m128i*) _positiveY));
+  __m128 posZ = _mm_castsi128_ps(_mm_load_si128((const __m128i*) _positiveZ));
+
+  __m128 nX = _mm_or_ps(_mm_and_ps(posX, minX), _mm_andnot_ps(posX, maxX));
+  __m128 nY = _mm_or_ps(_mm_and_ps(posY, minY), _mm_andnot_ps(posY, maxY));
+  __m128 nZ = _mm_or_ps(_mm_and_ps(posZ, minZ), _mm_andnot_ps(posZ, maxZ));
+  __m128 pX = _mm_or_ps(_mm_and_ps(posX, maxX), _mm_andnot_ps(posX, minX));
+  __m128 pY = _mm_or_ps(_mm_and_ps(posY, maxY), _mm_andnot_ps(posY, minY));
+  __m128 pZ = _mm_or_ps(_mm_and_ps(posZ, maxZ), _mm_andnot_ps(posZ, minZ));
+
+  __m128 planeX = _mm_load_ps(_planeX);
+  __m128 planeY = _mm_load_ps(_planeY);
+  __m128 planeZ = _mm_load_ps(_planeZ);
+  __m128 planeD = _mm_load_ps(_planeD);
+
+  __m128 nDot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planeX, nX), _mm_mul_ps(planeY, nY)),
+                           _mm_add_ps(_mm_mul_ps(planeZ, nZ), planeD));
+  __m128 pDot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planeX, pX), _mm_mul_ps(planeY, pY)),
+                           _mm_add_ps(_mm_mul_ps(planeZ, pZ), planeD));
+
+  outside = _mm_movemask_ps(_mm_cmpge_ps(nDot, _mm_setzero_ps()));
+  inside  = _mm_movemask_ps(_mm_cmplt_ps(pDot, _mm_setzero_ps()));
+
+#elif defined(QUADTREE_NEON)
+  float32x4_t minX = vdupq_n_f32(boxMin.x), maxX = vdupq_n_f32(boxMax.x);
+  float32x4_t minY = vdupq_n_f32(boxMin.y), maxY = vdupq_n_f32(boxMax.y);
+  float32x4_t minZ = vdupq_n_f32(boxMin.z), maxZ = vdupq_n_f32(boxMax.z);
+
+  uint32x4_t posX = vld1q_u32(_positiveX);
+  uint32x4_t posY = vld1q_u32(_positiveY);
+  uint32x4_t posZ = vld1q_u32(_positiveZ);
+
+  float32x4_t planeX = vld1q_f32(_planeX);
+  float32x4_t planeY = vld1q_f32(_planeY);
+  float32x4_t planeZ = vld1q_f32(_planeZ);
+  float32x4_t planeD = vld1q_f32(_planeD);
+
+  float32x4_t nDot = vmlaq_f32(vmlaq_f32(vmlaq_f32(planeD,
+    planeX, vbslq_f32(posX, minX, maxX)),
+    planeY, vbslq_f32(posY, minY, maxY)),
+    planeZ, vbslq_f32(posZ, minZ, maxZ));
+  float32x4_t pDot = vmlaq_f32(vmlaq_f32(vmlaq_f32(planeD,
+    planeX, vbslq_f32(posX, maxX, minX)),
+    planeY, vbslq_f32(posY, maxY, minY)),
+    planeZ, vbslq_f32(posZ, maxZ, minZ));
+
+  const uint32_t bitsArray[4] = {1, 2, 4, 8};
+  uint32x4_t bits = vld1q_u32(bitsArray);
+
+  uint32x4_t outsideBits = vandq_u32(vcgeq_f32(nDot, vdupq_n_f32(0.f)), bits);
+  uint32x4_t insideBits  = vandq_u32(vcltq_f32(pDot, vdupq_n_f32(0.f)), bits);
+
+  uint32x2_t outsideSum = vadd_u32(vget_low_u32(outsideBits), vget_high_u32(outsideBits));
+  uint32x2_t insideSum  = vadd_u32(vget_low_u32(insideBits),  vget_high_u32(insideBits));
+
+  outside = vget_lane_u32(vpadd_u32(outsideSum, outsideSum), 0);
+  inside  = vget_lane_u32(vpadd_u32(insideSum,  insideSum),  0);
+
+#else
+  outside = 0;
+  inside = 0;
+
+  for (int i = 0; i < QUADTREE_MAX_PLANES; i++) {
+    glm::vec3 nVertex(_positiveX[i] ? boxMin.x : boxMax.x,
+                      _positiveY[i] ? boxMin.y : boxMax.y,
+                      _positiveZ[i] ? boxMin.z : boxMax.z);
+    glm::vec3 pVertex(_positiveX[i] ? boxMax.x : boxMin.x,
+                      _positiveY[i] ? boxMax.y : boxMin.y,
+                      _positiveZ[i] ? boxMax.z : boxMin.z);
+
+    if (_planeX[i]*nVertex.x + _planeY[i]*nVertex.y + _planeZ[i]*nVertex.z + _planeD[i] >= 0)
+      outside |= 1 << i;
+    if (_planeX[i]*pVertex.x + _planeY[i]*pVertex.y + _planeZ[i]*pVertex.z + _planeD[i] < 0)
+      inside |= 1 << i;
+  }
+#endif
+}
+
+void ChunkQuadtree::computeCulling(const std::vector<glm::vec3>& planeNormals, glm::vec3 camPos,
+                                   const std::vector<std::unique_ptr<Chunk> >& terrain) {
+  _nbNodesTested = 0;
+
+  if (_nodes.empty())
+    return;
+
+  setPlanes(planeNormals, camPos);
+
+  uint32_t activePlanes = (1 << std::min(planeNormals.size(), (size_t) QUADTREE_MAX_PLANES)) - 1;
+  cullNode(0, activePlanes, terrain);
+}
+
+void ChunkQuadtree::cullNode(size_t node, uint32_t activePlanes, const std::vector<std::unique_ptr<Chunk> >& terrain) {
+  const Node& current = _nodes[node];
+
+  // Empty box, nothing to display
+  if (current.boxMin.x > current.boxMax.x) {
+    setSubtreeVisibility(node, false, terrain);
+    return;
+  }
+
+  uint32_t outside, inside;
+  testBox(current.boxMin, current.boxMax, outside, inside);
+  _nbNodesTested++;
+
+  if (outside & activePlanes) {
+    setSubtreeVisibility(node, false, terrain);
+    return;
+  }
+
+  // The children are inside the planes that contain their parent
+  activePlanes &= ~inside;
+
+  if (activePlanes == 0) {
+    setSubtreeVisibility(node, true, terrain);
+    return;
+  }
+
+  if (current.chunk >= 0)
+    terrain[current.chunk]->setVisible(true);
+
+  for (size_t i = 0; i < current.children.size(); i++) {
+    cullNode(current.children[i], activePlanes, terrain);
+  }
+}
+
+void ChunkQuadtree::setSubtreeVisibility(size_t node, bool visible, const std::vector<std::unique_ptr<Chunk> >& terrain) {
+  const Node& current = _nodes[node];
+
+  // Chunks without any vertex are never displayed
+  if (current.chunk >= 0)
+    terrain[current.chunk]->setVisible(visible && current.boxMin.x <= current.boxMax.x);
+
+  for (size_t i = 0; i < current.children.size(); i++) {
+    setSubtreeVisibility(current.children[i], visible, terrain);
+  }
+}
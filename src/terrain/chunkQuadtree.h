@@ -0,0 +1,67 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <memory>
+#include <stddef.h> // size_t
+#include <stdint.h>
+#include <vector>
+
+class Chunk;
+
+// Maximum number of frustum planes handled, one SIMD register
+#define QUADTREE_MAX_PLANES 4
+
+/** Quadtree of the chunks bounding boxes used for frustum culling.
+  * Each node is tested only against the planes its parent intersects, so that
+  * whole subtrees are accepted or rejected at once.
+  */
+class ChunkQuadtree {
+public:
+  ChunkQuadtree();
+
+  // Creates the hierarchy over a square of nbChunks*nbChunks chunks (x*nbChunks + y)
+  void build(size_t nbChunks);
+  // Updates the bounding boxes of the nodes from the ones of the chunks
+  void refit(const std::vector<std::unique_ptr<Chunk> >& terrain);
+
+  // Sets the visibility of every chunk
+  // The planes pass through camPos, their normals point outside of the frustum
+  void computeCulling(const std::vector<glm::vec3>& planeNormals, glm::vec3 camPos,
+                      const std::vector<std::unique_ptr<Chunk> >& terrain);
+
+  inline size_t getNbNodesTested() const {return _nbNodesTested;}
+
+private:
+  struct Node {
+    glm::vec3 boxMin;
+    glm::vec3 boxMax;
+    int chunk; // Index of the chunk for leaves, -1 otherwise
+    std::vector<size_t> children;
+  };
+
+  size_t buildNode(size_t xBegin, size_t yBegin, size_t xEnd, size_t yEnd, size_t nbChunks);
+  void refitNode(size_t node, const std::vector<std::unique_ptr<Chunk> >& terrain);
+  void cullNode(size_t node, uint32_t activePlanes, const std::vector<std::unique_ptr<Chunk> >& terrain);
+  void setSubtreeVisibility(size_t node, bool visible, const std::vector<std::unique_ptr<Chunk> >& terrain);
+
+  void setPlanes(const std::vector<glm::vec3>& planeNormals, glm::vec3 camPos);
+  // Tests the box against all the planes at once. Bit i of outside is set if
+  // the box is fully outside plane i, bit i of inside if it is fully inside
+  void testBox(glm::vec3 boxMin, glm::vec3 boxMax, uint32_t& outside, uint32_t& inside) const;
+
+  std::vector<Node> _nodes;
+
+  // Planes in SoA layout: the point p is inside plane i if dot(n_i,p) + d_i < 0
+  alignas(16) float _planeX[QUADTREE_MAX_PLANES];
+  alignas(16) float _planeY[QUADTREE_MAX_PLANES];
+  alignas(16) float _planeZ[QUADTREE_MAX_PLANES];
+  alignas(16) float _planeD[QUADTREE_MAX_PLANES];
+  // All bits set if the component of the normal is positive, to pick the box corners
+  alignas(16) uint32_t _positiveX[QUADTREE_MAX_PLANES];
+  alignas(16) uint32_t _positiveY[QUADTREE_MAX_PLANES];
+  alignas(16) uint32_t _positiveZ[QUADTREE_MAX_PLANES];
+
+  size_t _nbNodesTested;
+};
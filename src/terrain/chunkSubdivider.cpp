@@ -1,50 +1,135 @@
 #include "chunkSubdivider.h"
 
 #include "chunk.h"
+#include "contentGenerator.h"
 
-ChunkSubdivider::ChunkSubdivider ():
+ChunkSubdivider::ChunkSubdivider (const ContentGenerator& contentGenerator):
+  _contentGenerator(contentGenerator),
   _continue(true),
+  _nbTasksRunning(0),
   _computingThread(&ChunkSubdivider::executeTasks, this) {}
 
+ChunkSubdivider::~ChunkSubdivider () {}
+
 void ChunkSubdivider::executeTasks() {
   while (_continue) {
     std::unique_lock<std::mutex> lockQueue(_mutexQueue);
-    while (_taskQueue.empty()) {
+    while (_taskQueue.empty() && _prefetchQueue.empty()) {
       _cvQueueNotEmpty.wait(lockQueue);
       if (!_continue)
         return;
     }
+
+    Task task;
+
+    if (!_taskQueue.empty()) {
+      task = _taskQueue.front();
+      _taskQueue.pop();
+    }
+
+    else {
+      task = _prefetchQueue.front();
+      _prefetchQueue.pop_front();
+    }
+
+    _nbTasksRunning++;
     lockQueue.unlock();
 
-    Task task = _taskQueue.front();
+    if (task.forest) {
+      std::unique_ptr<ForestResult> result(new ForestResult());
+      result->chunk = task.chunk;
+      result->trees = _contentGenerator.genForestsInChunk(task.chunk->getChunkPos().x, task.chunk->getChunkPos().y);
+      _completedForests.push(std::move(result));
+    }
 
-    task.chunk->generateSubdivisionLevel(task.subdivLvl);
+    else {
+      std::unique_ptr<SubdivisionResult> result = task.chunk->generateSubdivisionLevel(task.subdivLvl, task.skirtDepth);
+      result->chunk = task.chunk;
+      _completedTasks.push(std::move(result));
+    }
 
     lockQueue.lock();
-    _taskQueue.pop();
-    if (_taskQueue.size() == 0)
-      _cvTasksCompleted.notify_one();
+    _nbTasksRunning--;
+    if (_taskQueue.empty() && _prefetchQueue.empty() && _nbTasksRunning == 0)
+      _cvTasksCompleted.notify_all();
+  }
+}
+
+void ChunkSubdivider::applyCompletedTasks() {
+  std::unique_ptr<SubdivisionResult> result;
+
+  while (_completedTasks.pop(result)) {
+    result->chunk->applySubdivisionLevel(*result);
+  }
+
+  std::unique_ptr<ForestResult> forest;
+
+  while (_completedForests.pop(forest)) {
+    _forestsWaiting.push_back(std::move(forest));
+  }
+
+  for (auto it = _forestsWaiting.begin(); it != _forestsWaiting.end(); ) {
+    if (!(*it)->chunk->hasPendingSubdivision()) {
+      (*it)->chunk->setTrees((*it)->trees);
+      it = _forestsWaiting.erase(it);
+    }
+
+    else
+      it++;
   }
 }
 
 void ChunkSubdivider::join() {
-  _continue = false;
+  {
+    // Under the lock so that the wake up cannot be missed
+    std::unique_lock<std::mutex> lockQueue(_mutexQueue);
+    _continue = false;
+  }
   _cvQueueNotEmpty.notify_one();
   _computingThread.join();
 }
 
 void ChunkSubdivider::waitForTasksToFinish() {
   std::unique_lock<std::mutex> lockQueue(_mutexQueue);
-  while (!_taskQueue.empty()) {
+  while (!_taskQueue.empty() || !_prefetchQueue.empty() || _nbTasksRunning != 0) {
     _cvTasksCompleted.wait(lockQueue);
   }
 }
 
-void ChunkSubdivider::addTask(Chunk* chunk, size_t subdivLvl) {
+void ChunkSubdivider::addTask(Chunk* chunk, size_t subdivLvl, bool prefetch) {
+  pushTask({chunk, subdivLvl, chunk->getSkirtDepth(), false}, prefetch);
+}
+
+void ChunkSubdivider::addForestTask(Chunk* chunk, bool prefetch) {
+  pushTask({chunk, 0, 0.f, true}, prefetch);
+}
+
+void ChunkSubdivider::pushTask(const Task& task, bool prefetch) {
+  std::unique_lock<std::mutex> lockQueue(_mutexQueue);
+
+  if (prefetch)
+    _prefetchQueue.push_back(task);
+  else
+    _taskQueue.push(task);
+
+  _cvQueueNotEmpty.notify_one();
+}
+
+void ChunkSubdivider::promoteTasks(Chunk* chunk) {
   std::unique_lock<std::mutex> lockQueue(_mutexQueue);
-  _taskQueue.push({chunk, subdivLvl});
 
-  if (_taskQueue.size() == 1) {
-    _cvQueueNotEmpty.notify_one();
+  for (auto it = _prefetchQueue.begin(); it != _prefetchQueue.end(); ) {
+    if (it->chunk == chunk) {
+      _taskQueue.push(*it);
+      it = _prefetchQueue.erase(it);
+    }
+
+    else
+      it++;
   }
 }
+
+size_t ChunkSubdivider::getNbTasksInQueue() const {
+  std::unique_lock<std::mutex> lockQueue(_mutexQueue);
+  return _taskQueue.size() + _prefetchQueue.size() + _nbTasksRunning;
+}
@@ -2,36 +2,78 @@
 
 #include <atomic>
 #include <condition_variable>
+#include <deque>
+#include <memory>
 #include <mutex>
 #include <queue>
 #include <stddef.h> // size_t
 #include <thread>
+#include <vector>
+
+#include "mpscQueue.h"
 
 class Chunk;
+class ContentGenerator;
+class igElement;
+struct SubdivisionResult;
 
 struct Task {
   Chunk* chunk;
   size_t subdivLvl;
+  float skirtDepth; // Read on the main thread when the task is added
+  bool forest; // Generates the forests of the chunk instead of a subdivision level
+};
+
+struct ForestResult {
+  Chunk* chunk;
+  std::vector<igElement*> trees;
 };
 
+/** Generates the subdivision levels of the chunks on a separate thread.
+  * The worker only reads immutable data of the chunks and produces a result per
+  * task. The results are published through a lock-free queue and moved into
+  * their chunks by the main thread in applyCompletedTasks.
+  * Prefetch tasks are only executed when no task needed for the current frame
+  * is waiting, they can be promoted when the chunk finally needs them.
+  * The forests of the chunks are generated by the same thread, the first time
+  * the chunks are needed. They are given to the chunks once no subdivision of
+  * the chunk is pending, as the subdivisions read the trees.
+  */
 class ChunkSubdivider {
 public:
-  ChunkSubdivider ();
+  ChunkSubdivider (const ContentGenerator& contentGenerator);
+  ~ChunkSubdivider ();
 
-  void addTask(Chunk* chunk, size_t subdivLvl);
+  void addTask(Chunk* chunk, size_t subdivLvl, bool prefetch = false);
+  void addForestTask(Chunk* chunk, bool prefetch = false);
+  // Moves the prefetch tasks of the chunk to the regular queue, in the same order
+  void promoteTasks(Chunk* chunk);
+  // Must be called from the main thread
+  void applyCompletedTasks();
 
   void join();
   void waitForTasksToFinish();
 
-  inline size_t getNbTasksInQueue() const {return _taskQueue.size();}
+  size_t getNbTasksInQueue() const;
 
 private:
   void executeTasks();
+  void pushTask(const Task& task, bool prefetch);
+
+  const ContentGenerator& _contentGenerator;
 
   std::atomic<bool> _continue;
   std::condition_variable _cvQueueNotEmpty;
   std::condition_variable _cvTasksCompleted;
-  std::mutex _mutexQueue;
+  mutable std::mutex _mutexQueue;
   std::queue<Task> _taskQueue;
+  std::deque<Task> _prefetchQueue;
+  size_t _nbTasksRunning;
+
+  MPSCQueue<std::unique_ptr<SubdivisionResult> > _completedTasks;
+  MPSCQueue<std::unique_ptr<ForestResult> > _completedForests;
+  // Main thread only
+  std::vector<std::unique_ptr<ForestResult> > _forestsWaiting;
+
   std::thread _computingThread;
 };
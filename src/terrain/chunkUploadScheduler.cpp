@@ -0,0 +1,74 @@
+#include "chunkUploadScheduler.h"
+
+#include <SDL.h>
+
+#include <algorithm>
+
+#include "chunk.h"
+
+ChunkUploadScheduler::ChunkUploadScheduler(size_t bytesBudget, float msBudget) :
+  _bytesBudget(bytesBudget),
+  _msBudget(msBudget),
+  _lastBytesUploaded(0),
+  _lastUploadTime(0.f) {}
+
+void ChunkUploadScheduler::requestUpload(Chunk* chunk, size_t subdivLvl, bool prefetch) {
+  std::pair<Chunk*, size_t> request(chunk, subdivLvl);
+
+  if (_pendingRequests.insert(request).second) {
+    if (prefetch)
+      _prefetchRequests.push_back(request);
+    else
+      _requests.push_back(request);
+  }
+
+  else if (!prefetch) {
+    auto prefetchRequest = std::find(_prefetchRequests.begin(), _prefetchRequests.end(), request);
+
+    if (prefetchRequest != _prefetchRequests.end()) {
+      _prefetchRequests.erase(prefetchRequest);
+      _requests.push_back(request);
+    }
+  }
+}
+
+void ChunkUploadScheduler::processUploads() {
+  processUploads(true);
+}
+
+void ChunkUploadScheduler::processAllUploads() {
+  processUploads(false);
+}
+
+void ChunkUploadScheduler::processUploads(bool withBudget) {
+  uint64_t start = SDL_GetPerformanceCounter();
+
+  _lastBytesUploaded = 0;
+  _lastUploadTime = 0.f;
+
+  if (processRequests(_requests, withBudget, start))
+    processRequests(_prefetchRequests, withBudget, start);
+}
+
+bool ChunkUploadScheduler::processRequests(std::deque<std::pair<Chunk*, size_t> >& requests,
+                                           bool withBudget, uint64_t start) {
+  float msPerTick = 1000.f / SDL_GetPerformanceFrequency();
+
+  while (!requests.empty()) {
+    std::pair<Chunk*, size_t> request = requests.front();
+
+    if (withBudget && _lastBytesUploaded > 0) {
+      if (_lastBytesUploaded + request.first->getUploadSize(request.second) > _bytesBudget ||
+          _lastUploadTime >= _msBudget)
+        return false;
+    }
+
+    requests.pop_front();
+    _pendingRequests.erase(request);
+
+    _lastBytesUploaded += request.first->uploadSubdivisionLevel(request.second);
+    _lastUploadTime = (SDL_GetPerformanceCounter() - start) * msPerTick;
+  }
+
+  return true;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <deque>
+#include <set>
+#include <stddef.h> // size_t
+#include <stdint.h>
+#include <utility>
+
+class Chunk;
+
+// Default budgets for the uploads of the chunk LODs in a frame
+#define UPLOAD_BYTES_PER_FRAME (4*1024*1024)
+#define UPLOAD_MS_PER_FRAME 2.f
+
+/** Spreads the uploads of the newly generated subdivision levels over the frames.
+  * The chunks ask for the upload of the level they want to display and keep the
+  * closest uploaded level meanwhile. Each frame, the requests are processed in
+  * order until the byte or the time budget is exhausted. The prefetch requests
+  * only use the budget left by the regular ones.
+  */
+class ChunkUploadScheduler {
+public:
+  ChunkUploadScheduler(size_t bytesBudget = UPLOAD_BYTES_PER_FRAME, float msBudget = UPLOAD_MS_PER_FRAME);
+
+  inline void setBudgets(size_t bytesBudget, float msBudget) {_bytesBudget = bytesBudget; _msBudget = msBudget;}
+
+  // Does nothing if the level is already waiting, except promoting a prefetch request to a regular one
+  void requestUpload(Chunk* chunk, size_t subdivLvl, bool prefetch = false);
+  // Called once per frame. At least one upload is done so that the queue always progresses
+  void processUploads();
+  // Uploads everything without budget, during loading
+  void processAllUploads();
+
+  inline size_t getNbPendingUploads() const {return _requests.size() + _prefetchRequests.size();}
+  inline size_t getLastBytesUploaded() const {return _lastBytesUploaded;}
+  inline float getLastUploadTime() const {return _lastUploadTime;}
+
+private:
+  void processUploads(bool withBudget);
+  // Returns false when the budget is exhausted
+  bool processRequests(std::deque<std::pair<Chunk*, size_t> >& requests, bool withBudget, uint64_t start);
+
+  size_t _bytesBudget;
+  float _msBudget;
+
+  std::deque<std::pair<Chunk*, size_t> > _requests;
+  std::deque<std::pair<Chunk*, size_t> > _prefetchRequests;
+  std::set<std::pair<Chunk*, size_t> > _pendingRequests; // Regular and prefetch ones
+
+  size_t _lastBytesUploaded;
+  float _lastUploadTime; // In ms
+};
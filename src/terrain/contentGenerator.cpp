@@ -2,18 +2,21 @@
 
 #include <algorithm>
 #include <cstdlib>
+#include <random>
 #include <sstream>
 
-#include "antilope.h"
+#include "herdStore.h"
 #include "lion.h"
 #include "tree.h"
 
 #define CONTENT_RES 512
+// Number of random positions tried to place a herd on the whole map
+#define HERDS_ATTEMPTS 800
 
 ContentGenerator::ContentGenerator(const TerrainGeometry& terrainGeometry) :
   _terrainGeometry(terrainGeometry),
   _perlinGenerator(3, 0.06, 0.75, CONTENT_RES),
-  _treesInChunk(NB_CHUNKS * NB_CHUNKS) {
+  _forestsSeed(0) {
 
   std::vector<bool> initForestsMask(CONTENT_RES,false);
   _forestsMask = std::vector<std::vector<bool> >(CONTENT_RES, initForestsMask);
@@ -29,6 +32,7 @@ void ContentGenerator::init() {
   }
 
   _treeTexManager.load("res/trees/");
+  _forestsSeed = rand();
 
   #pragma omp parallel for
   for (int i = 0 ; i < CONTENT_RES ; i++) {
@@ -44,19 +48,17 @@ bool ContentGenerator::isInForestMask(glm::vec2 pos) const {
                      [(int) (pos.y / MAX_COORD * CONTENT_RES)];
 }
 
-bool ContentGenerator::notTooCloseToOtherTrees(glm::vec2 pos, float distance) const {
-  for (int i = std::max((int) ((pos.x - distance)/CHUNK_SIZE), 0);
-           i < std::min((int) ((pos.x + distance)/CHUNK_SIZE), NB_CHUNKS); i++) {
-  for (int j = std::max((int) ((pos.y - distance)/CHUNK_SIZE), 0);
-           j < std::min((int) ((pos.y + distance)/CHUNK_SIZE), NB_CHUNKS); j++) {
+bool ContentGenerator::notTooCloseToOtherTrees(glm::vec2 pos, float distance, glm::vec2 chunkPos,
+                                               const std::vector<glm::vec2>& treesInChunk) const {
+  glm::vec2 posInChunk = pos - chunkPos;
 
-    for (auto it = _treesInChunk[i*NB_CHUNKS +j].begin();
-             it != _treesInChunk[i*NB_CHUNKS +j].end(); it++) {
+  if (posInChunk.x < distance / 2 || posInChunk.x > CHUNK_SIZE - distance / 2 ||
+      posInChunk.y < distance / 2 || posInChunk.y > CHUNK_SIZE - distance / 2)
+    return false;
 
-      if (glm::length(pos - (*it)) < distance)
-        return false;
-    }
-  }
+  for (size_t i = 0; i < treesInChunk.size(); i++) {
+    if (glm::length(pos - treesInChunk[i]) < distance)
+      return false;
   }
 
   return true;
@@ -64,30 +66,40 @@ bool ContentGenerator::notTooCloseToOtherTrees(glm::vec2 pos, float distance) co
 
 struct compTrees {
   bool operator()(const igElement* lhs, const igElement* rhs) const {
-    const Tree* tLHS = dynamic_cast<const Tree*>(lhs);
-    const Tree* tRHS = dynamic_cast<const Tree*>(rhs);
+    // Only trees are sorted
+    const Tree* tLHS = static_cast<const Tree*>(lhs);
+    const Tree* tRHS = static_cast<const Tree*>(rhs);
     return tLHS->getBiome() < tRHS->getBiome();
   }
 };
 
-std::vector<igElement*> ContentGenerator::genForestsInChunk(size_t x, size_t y) {
+std::vector<igElement*> ContentGenerator::genForestsInChunk(size_t x, size_t y) const {
   glm::vec2 chunkPos(x*CHUNK_SIZE, y*CHUNK_SIZE);
   std::vector<igElement*> res;
+  std::vector<glm::vec2> treesInChunk;
+
+  std::seed_seq seed = {_forestsSeed, (unsigned int) x, (unsigned int) y};
+  std::mt19937 randomEngine(seed);
+  std::uniform_real_distribution<float> random(0.f, 1.f);
 
   for (int i = 0; i < 2400; i++) {
-    glm::vec2 pos(RANDOMF * CHUNK_SIZE, RANDOMF * CHUNK_SIZE);
+    glm::vec2 pos(random(randomEngine) * CHUNK_SIZE, random(randomEngine) * CHUNK_SIZE);
     pos += chunkPos;
 
+    // Drawn for every candidate so that the sequence does not depend on the tests
+    float treeType = random(randomEngine);
+    float orientation = random(randomEngine) * 360.f;
+
     Biome biomeInPos = _terrainGeometry.getBiome(pos,1);
 
     if (biomeInPos != Biome::BIOME_NB_ITEMS) {
       if ((int) biomeInPos >= 11) { // No forests in other biomes
         if (isInForestMask(pos)) {
-          if (notTooCloseToOtherTrees(pos, _treeTexManager.getDensity(biomeInPos))) {
-            _treesInChunk[x*NB_CHUNKS + y].push_back(pos);
+          if (notTooCloseToOtherTrees(pos, _treeTexManager.getDensity(biomeInPos), chunkPos, treesInChunk)) {
+            treesInChunk.push_back(pos);
 
             res.push_back(new Tree(pos, _treeTexManager, biomeInPos,
-              (int) ((RANDOMF - 0.01f) * _treeTexManager.getNBTrees(biomeInPos))));
+              (int) ((treeType - 0.01f) * _treeTexManager.getNBTrees(biomeInPos)), orientation));
           }
         }
       }
@@ -95,33 +107,39 @@ std::vector<igElement*> ContentGenerator::genForestsInChunk(size_t x, size_t y)
   }
 
   // Sorting reduces the number of glCalls to display all the trees
-  std::sort(res.begin(), res.end(), compTrees());
+  std::stable_sort(res.begin(), res.end(), compTrees());
 
   return res;
 }
 
-std::vector<igMovingElement*> ContentGenerator::genHerds() const {
-  std::vector<igMovingElement*> res;
-
-  for (int i = 0; i < 800; i++) {
-    glm::vec2 pos(RANDOMF * MAX_COORD, RANDOMF * MAX_COORD);
+void ContentGenerator::genHerds(HerdStore& herds) const {
+  for (int i = 0; i < HERDS_ATTEMPTS; i++) {
+    genHerdAtPos(herds, glm::vec2(RANDOMF * MAX_COORD, RANDOMF * MAX_COORD));
+  }
+}
 
-    Biome biomeInPos = _terrainGeometry.getBiome(pos,1);
+void ContentGenerator::genHerdsInChunk(HerdStore& herds, size_t x, size_t y) const {
 
-    if (biomeInPos == Biome::TEMPERATE_RAIN_FOREST ||
-        biomeInPos == Biome::TEMPERATE_DECIDUOUS_FOREST ||
-        biomeInPos == Biome::GRASSLAND) {
-      std::vector<igMovingElement*> newItems = genHerd(pos, RANDOMF * 15 + 5, Animals::DEER);
-      res.insert(res.end(), newItems.begin(), newItems.end());
-    }
+  // The fractional part of the number of attempts per chunk is drawn randomly
+  float attemptsInChunk = HERDS_ATTEMPTS / (float) (NB_CHUNKS * NB_CHUNKS);
+  int nbAttempts = (int) attemptsInChunk + (RANDOMF < attemptsInChunk - (int) attemptsInChunk ? 1 : 0);
 
-    else if (biomeInPos == Biome::TROPICAL_SEASONAL_FOREST) {
-      std::vector<igMovingElement*> newItems = genHerd(pos, RANDOMF * 25 + 10, Animals::ANTILOPE);
-      res.insert(res.end(), newItems.begin(), newItems.end());
-    }
+  for (int i = 0; i < nbAttempts; i++) {
+    glm::vec2 pos((x + RANDOMF) * CHUNK_SIZE, (y + RANDOMF) * CHUNK_SIZE);
+    genHerdAtPos(herds, pos);
   }
+}
 
-  return res;
+void ContentGenerator::genHerdAtPos(HerdStore& herds, glm::vec2 pos) const {
+  Biome biomeInPos = _terrainGeometry.getBiome(pos,1);
+
+  if (biomeInPos == Biome::TEMPERATE_RAIN_FOREST ||
+      biomeInPos == Biome::TEMPERATE_DECIDUOUS_FOREST ||
+      biomeInPos == Biome::GRASSLAND)
+    genHerd(herds, pos, RANDOMF * 15 + 5, Animals::DEER);
+
+  else if (biomeInPos == Biome::TROPICAL_SEASONAL_FOREST)
+    genHerd(herds, pos, RANDOMF * 25 + 10, Animals::ANTILOPE);
 }
 
 std::vector<glm::vec2> ContentGenerator::scatteredPositions(glm::vec2 center,
@@ -162,16 +180,8 @@ std::vector<glm::vec2> ContentGenerator::scatteredPositions(glm::vec2 center,
   return res;
 }
 
-std::vector<igMovingElement*> ContentGenerator::genHerd(glm::vec2 pos, size_t count, Animals animal) const {
-  std::vector<igMovingElement*> res;
-
-  std::vector<glm::vec2> positions = scatteredPositions(pos, count, 10, 5);
-
-  for (int i = 0; i < positions.size(); i++) {
-    res.push_back(new Antilope(positions[i], AnimationManager(getAnimManagerInit(animal)), _terrainGeometry));
-  }
-
-  return res;
+void ContentGenerator::genHerd(HerdStore& herds, glm::vec2 pos, size_t count, Animals animal) const {
+  herds.addHerd(scatteredPositions(pos, count, 10, 5), getAnimManagerInit(animal));
 }
 
 std::vector<igMovingElement*> ContentGenerator::genTribe(glm::vec2 pos) const {
@@ -11,6 +11,7 @@
 #include "perlin.h"
 #include "utils.h"
 
+class HerdStore;
 class igElement;
 class igMovingElement;
 
@@ -22,9 +23,13 @@ public:
 
   void saveToImage(std::string savename) const;
 
-  std::vector<igElement*> genForestsInChunk(size_t x, size_t y);
-  std::vector<igMovingElement*> genHerds() const;
-  std::vector<igMovingElement*> genHerd(glm::vec2 pos, size_t count, Animals animal) const;
+  // Thread safe and deterministic: the forests of a chunk do not depend on the generation order
+  std::vector<igElement*> genForestsInChunk(size_t x, size_t y) const;
+  // The herd animals are added to herds
+  void genHerds(HerdStore& herds) const;
+  // Same density of herds as genHerds, restricted to one chunk
+  void genHerdsInChunk(HerdStore& herds, size_t x, size_t y) const;
+  void genHerd(HerdStore& herds, glm::vec2 pos, size_t count, Animals animal) const;
   std::vector<igMovingElement*> genTribe(glm::vec2 pos) const;
   std::vector<igMovingElement*> genLion(glm::vec2 pos) const;
 
@@ -33,8 +38,12 @@ public:
 private:
   inline const AnimationManagerInitializer& getAnimManagerInit(Animals animal) const {return _animManagerInits[(int) animal];}
 
+  void genHerdAtPos(HerdStore& herds, glm::vec2 pos) const;
   bool isInForestMask(glm::vec2 pos) const;
-  bool notTooCloseToOtherTrees(glm::vec2 pos, float distance) const;
+  // Only the trees of the same chunk are tested, the trees closer than distance/2 to the border
+  // of the chunk are rejected instead
+  bool notTooCloseToOtherTrees(glm::vec2 pos, float distance, glm::vec2 chunkPos,
+                               const std::vector<glm::vec2>& treesInChunk) const;
   // Generates randomly count positions around center within a radius radius.
   // Two individuals cannot be closer than minProximity and cannot be on water.
   // The function might return less than count positions if they are not suitable
@@ -45,10 +54,8 @@ private:
   Perlin _perlinGenerator;
 
   std::vector<std::vector<bool> > _forestsMask;
-
-  // Contains the trees that are in a given Chunk
-	// The chunks are sorted as chunk.x * NB_CHUNKS + chunk.y
-  std::vector<std::list<glm::vec2> > _treesInChunk;
+  // Combined with the chunk coordinates to seed the generation of its forests
+  unsigned int _forestsSeed;
 
   std::vector<AnimationManagerInitializer> _animManagerInits;
   TreeTexManager _treeTexManager;
@@ -0,0 +1,122 @@
+#include "forestImpostorBaker.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <limits>
+
+#include "chunk.h"
+#include "forestImpostor.h"
+#include "utils.h"
+
+ForestImpostorBaker::ForestImpostorBaker() :
+  _nbChunksBaked(0) {
+
+  _impostorTextures.allocate(NB_CHUNKS*NB_CHUNKS, glm::uvec2(IMPOSTOR_CELLS * IMPOSTOR_TEX_SIZE));
+  _fbo.init(IMPOSTOR_CELLS * IMPOSTOR_TEX_SIZE, IMPOSTOR_CELLS * IMPOSTOR_TEX_SIZE,
+    GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE);
+}
+
+void ForestImpostorBaker::update(const std::vector<std::unique_ptr<Chunk> >& terrain, const Shader& igEShader) {
+  size_t nbBakes = 0;
+
+  for (size_t i = 0; i < terrain.size() && nbBakes < IMPOSTOR_BAKES_PER_FRAME; i++) {
+    if (terrain[i]->needsImpostors()) {
+      bake(*terrain[i], igEShader);
+      nbBakes++;
+    }
+  }
+
+  _nbChunksBaked += nbBakes;
+}
+
+void ForestImpostorBaker::bake(Chunk& chunk, const Shader& igEShader) {
+  const std::vector<igElement*>& trees = chunk.getTrees();
+  glm::vec2 chunkCorner = glm::vec2(chunk.getChunkPos()) * CHUNK_SIZE;
+  float cellSize = CHUNK_SIZE / IMPOSTOR_CELLS;
+
+  std::vector<std::vector<igElement*> > cells(IMPOSTOR_CELLS*IMPOSTOR_CELLS);
+
+  for (size_t i = 0; i < trees.size(); i++) {
+    glm::ivec2 cell = glm::clamp(glm::ivec2((trees[i]->getPos() - chunkCorner) / cellSize),
+                                 glm::ivec2(0), glm::ivec2(IMPOSTOR_CELLS - 1));
+    cells[cell.x*IMPOSTOR_CELLS + cell.y].push_back(trees[i]);
+  }
+
+  GLint viewport[4];
+  glGetIntegerv(GL_VIEWPORT, viewport);
+  GLfloat clearColor[4];
+  glGetFloatv(GL_COLOR_CLEAR_VALUE, clearColor);
+
+  _fbo.bind();
+  glClearColor(0.f, 0.f, 0.f, 0.f);
+  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+  // The trees are seen from the side along the x axis, the cards face the camera like every sprite
+  glm::vec3 eyeOffset(CHUNK_SIZE + 1.f, 0.f, 0.f);
+  glm::mat4 identity(1.f);
+
+  igEShader.bind();
+  glUniformMatrix4fv(igEShader.getUniformLocation("MODEL"), 1, GL_FALSE, &identity[0][0]);
+  glUniform1i(igEShader.getUniformLocation("onlyOpaqueParts"), true);
+
+  std::vector<igElement*> impostors;
+  size_t layer = chunk.getChunkPos().x * NB_CHUNKS + chunk.getChunkPos().y;
+  float texelSize = 1.f / (IMPOSTOR_CELLS * IMPOSTOR_TEX_SIZE);
+
+  for (int i = 0; i < IMPOSTOR_CELLS; i++) {
+    for (int j = 0; j < IMPOSTOR_CELLS; j++) {
+      const std::vector<igElement*>& cellTrees = cells[i*IMPOSTOR_CELLS + j];
+
+      if (cellTrees.empty())
+        continue;
+
+      float minY = std::numeric_limits<float>::max();
+      float maxY = - std::numeric_limits<float>::max();
+      float minZ = std::numeric_limits<float>::max();
+      float maxZ = - std::numeric_limits<float>::max();
+      float meanX = 0.f;
+
+      for (size_t k = 0; k < cellTrees.size(); k++) {
+        minY = std::min(minY, cellTrees[k]->getPos().y - cellTrees[k]->getSize().x / 2.f);
+        maxY = std::max(maxY, cellTrees[k]->getPos().y + cellTrees[k]->getSize().x / 2.f);
+        minZ = std::min(minZ, cellTrees[k]->getHeight());
+        maxZ = std::max(maxZ, cellTrees[k]->getHeight() + cellTrees[k]->getSize().y);
+        meanX += cellTrees[k]->getPos().x / cellTrees.size();
+      }
+
+      glm::vec3 target(chunkCorner.x, (minY + maxY) / 2.f, 0.f);
+      glm::mat4 VP = glm::ortho(- (maxY - minY) / 2.f, (maxY - minY) / 2.f, minZ, maxZ, 0.f, CHUNK_SIZE + 2.f) *
+                     glm::lookAt(target + eyeOffset, target, glm::vec3(0.f, 0.f, 1.f));
+
+      glUniformMatrix4fv(igEShader.getUniformLocation("VP"), 1, GL_FALSE, &VP[0][0]);
+      glUniform3fv(igEShader.getUniformLocation("camPos"), 1, &(target + eyeOffset)[0]);
+
+      // Cell (i,j) is stored at column j and row i of the layer
+      glViewport(j * IMPOSTOR_TEX_SIZE, i * IMPOSTOR_TEX_SIZE, IMPOSTOR_TEX_SIZE, IMPOSTOR_TEX_SIZE);
+
+      _cellDrawer.loadElements(cellTrees);
+      _cellDrawer.drawElements();
+
+      // The rows of the framebuffer go upwards, the top of the card is the end of the cell,
+      // half a texel inside to avoid bleeding from the neighbouring cells
+      glm::vec4 texRectangle(j * IMPOSTOR_TEX_SIZE * texelSize + texelSize / 2.f,
+                             (i+1) * IMPOSTOR_TEX_SIZE * texelSize - texelSize / 2.f,
+                             (IMPOSTOR_TEX_SIZE - 1) * texelSize,
+                           - (IMPOSTOR_TEX_SIZE - 1) * texelSize);
+
+      impostors.push_back(new ForestImpostor(glm::vec2(meanX, (minY + maxY) / 2.f), minZ,
+        glm::vec2(maxY - minY, maxZ - minZ), &_impostorTextures, layer, texRectangle));
+    }
+  }
+
+  Shader::unbind();
+
+  _impostorTextures.copyFromBoundFBO(layer);
+
+  FrameBufferObject::unbind();
+  glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+  glClearColor(clearColor[0], clearColor[1], clearColor[2], clearColor[3]);
+
+  chunk.setImpostors(impostors);
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <memory>
+#include <stddef.h> // size_t
+#include <vector>
+
+#include "frameBufferObject.h"
+#include "igElementDisplay.h"
+#include "shader.h"
+#include "texArray.h"
+
+class Chunk;
+
+// Number of impostors per side of a chunk
+#define IMPOSTOR_CELLS 4
+// Size of the picture of each impostor, in pixels
+#define IMPOSTOR_TEX_SIZE 32
+// Bakes are expensive, the chunks that need impostors get them over several frames
+#define IMPOSTOR_BAKES_PER_FRAME 2
+
+/** Replaces the trees of the distant chunks with a few cards.
+  * Each chunk is divided in IMPOSTOR_CELLS x IMPOSTOR_CELLS cells. The trees of a
+  * cell are rendered once, from the side and with an orthographic projection,
+  * into a part of the layer of the chunk in a texture array. The cell is then
+  * displayed as a single billboard carrying this picture.
+  */
+class ForestImpostorBaker {
+public:
+  ForestImpostorBaker();
+
+  // Bakes the impostors of the chunks that need them, within the budget of the frame
+  void update(const std::vector<std::unique_ptr<Chunk> >& terrain, const Shader& igEShader);
+
+  inline size_t getNbChunksBaked() const {return _nbChunksBaked;}
+
+private:
+  void bake(Chunk& chunk, const Shader& igEShader);
+
+  TextureArray _impostorTextures; // One layer per chunk
+  FrameBufferObject _fbo;
+  igElementDisplay _cellDrawer;
+
+  size_t _nbChunksBaked;
+};
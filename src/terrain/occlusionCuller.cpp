@@ -0,0 +1,261 @@
+#include "occlusionCuller.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "chunk.h"
+
+// Vertices closer than this distance to the camera plane are not projected
+#define OCCLUSION_NEAR_W 1.f
+// The occluders are pushed back to compensate for the differences between
+// their coarse geometry and the displayed one
+#define OCCLUSION_DEPTH_BIAS 0.05f
+// Maximum size in texels of the rectangle read in the pyramid for one box
+#define OCCLUSION_MAX_TEXELS 2
+
+OcclusionCuller::OcclusionCuller() :
+  _enabled(true),
+  _nbChunksCulled(0),
+  _nbContentsCulled(0) {
+
+  glm::uvec2 size(OCCLUSION_BUFFER_WIDTH, OCCLUSION_BUFFER_HEIGHT);
+  _levelSizes.push_back(size);
+
+  while (size.x > 1 || size.y > 1) {
+    size = glm::uvec2(std::max(1u, (size.x + 1) / 2), std::max(1u, (size.y + 1) / 2));
+    _levelSizes.push_back(size);
+  }
+
+  _pyramid.resize(_levelSizes.size());
+
+  for (size_t i = 0; i < _levelSizes.size(); i++) {
+    _pyramid[i].resize(_levelSizes[i].x * _levelSizes[i].y);
+  }
+}
+
+void OcclusionCuller::clear() {
+  std::fill(_pyramid[0].begin(), _pyramid[0].end(), std::numeric_limits<float>::max());
+}
+
+void OcclusionCuller::computeOcclusion(const std::vector<std::unique_ptr<Chunk> >& terrain, const glm::mat4& viewProjection) {
+  _nbChunksCulled = 0;
+  _nbContentsCulled = 0;
+
+  if (!_enabled) {
+    for (size_t i = 0; i < terrain.size(); i++) {
+      terrain[i]->setOcclusion(false, false);
+    }
+    return;
+  }
+
+  clear();
+
+  for (size_t i = 0; i < terrain.size(); i++) {
+    if (terrain[i]->isVisible())
+      rasterizeChunk(*terrain[i], viewProjection);
+  }
+
+  buildPyramid();
+
+  for (size_t i = 0; i < terrain.size(); i++) {
+    Chunk& chunk = *terrain[i];
+
+    if (!chunk.isVisible()) {
+      chunk.setOcclusion(false, false);
+      continue;
+    }
+
+    bool contentOccluded = isBoxOccluded(chunk.getBoundingBoxMin(), chunk.getContentBoundingBoxMax(), viewProjection);
+    // The content box contains the terrain box
+    bool terrainOccluded = contentOccluded ||
+      isBoxOccluded(chunk.getBoundingBoxMin(), chunk.getBoundingBoxMax(), viewProjection);
+
+    chunk.setOcclusion(terrainOccluded, contentOccluded);
+
+    if (terrainOccluded)
+      _nbChunksCulled++;
+    if (contentOccluded)
+      _nbContentsCulled++;
+  }
+}
+
+void OcclusionCuller::rasterizeChunk(const Chunk& chunk, const glm::mat4& viewProjection) {
+  const Buffers* occluder = chunk.getOccluderBuffers();
+
+  if (occluder == nullptr)
+    return;
+
+  const std::vector<float>& vertices = occluder->vertices;
+  _clipVertices.resize(vertices.size() / 3);
+
+  for (size_t i = 0; i < _clipVertices.size(); i++) {
+    _clipVertices[i] = viewProjection * glm::vec4(vertices[3*i], vertices[3*i+1], vertices[3*i+2], 1.f);
+  }
+
+  for (auto it = occluder->indicesInfo.begin(); it != occluder->indicesInfo.end(); it++) {
+    const std::vector<GLuint>& indices = it->second.indices;
+
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+      glm::vec3 screenVertices[3];
+      bool clipped = false;
+
+      for (size_t j = 0; j < 3; j++) {
+        const glm::vec4& clip = _clipVertices[indices[i+j]];
+
+        // Triangles crossing the near plane are not used as occluders
+        if (clip.w < OCCLUSION_NEAR_W) {
+          clipped = true;
+          break;
+        }
+
+        screenVertices[j] = glm::vec3((clip.x / clip.w * 0.5f + 0.5f) * OCCLUSION_BUFFER_WIDTH,
+                                      (clip.y / clip.w * 0.5f + 0.5f) * OCCLUSION_BUFFER_HEIGHT,
+                                      1.f / clip.w);
+      }
+
+      if (!clipped)
+        rasterizeTriangle(screenVertices[0], screenVertices[1], screenVertices[2]);
+    }
+  }
+}
+
+void OcclusionCuller::rasterizeTriangle(glm::vec3 v0, glm::vec3 v1, glm::vec3 v2) {
+  float area = (v1.x - v0.x) * (v2.y - v0.y) - (v1.y - v0.y) * (v2.x - v0.x);
+
+  if (std::abs(area) < 1e-6f)
+    return;
+
+  if (area < 0) {
+    std::swap(v1, v2);
+    area = -area;
+  }
+
+  int xMin = std::max(0, (int) std::floor(std::min(v0.x, std::min(v1.x, v2.x))));
+  int yMin = std::max(0, (int) std::floor(std::min(v0.y, std::min(v1.y, v2.y))));
+  int xMax = std::min(OCCLUSION_BUFFER_WIDTH - 1,  (int) std::floor(std::max(v0.x, std::max(v1.x, v2.x))));
+  int yMax = std::min(OCCLUSION_BUFFER_HEIGHT - 1, (int) std::floor(std::max(v0.y, std::max(v1.y, v2.y))));
+
+  if (xMin > xMax || yMin > yMax)
+    return;
+
+  // Edge i is the one opposite to vertex i
+  const glm::vec3* vert[3] = {&v0, &v1, &v2};
+  float edgeX[3], edgeY[3], margin[3];
+
+  for (int i = 0; i < 3; i++) {
+    const glm::vec3& a = *vert[(i+1)%3];
+    const glm::vec3& b = *vert[(i+2)%3];
+    edgeX[i] = b.x - a.x;
+    edgeY[i] = b.y - a.y;
+    // Only pixels fully covered by the triangle are written
+    margin[i] = 0.5f * (std::abs(edgeX[i]) + std::abs(edgeY[i]));
+  }
+
+  std::vector<float>& depthBuffer = _pyramid[0];
+
+  for (int y = yMin; y <= yMax; y++) {
+    for (int x = xMin; x <= xMax; x++) {
+      float px = x + 0.5f;
+      float py = y + 0.5f;
+      float weights[3];
+      bool inside = true;
+
+      for (int i = 0; i < 3; i++) {
+        const glm::vec3& a = *vert[(i+1)%3];
+        weights[i] = edgeX[i] * (py - a.y) - edgeY[i] * (px - a.x);
+
+        if (weights[i] < margin[i]) {
+          inside = false;
+          break;
+        }
+      }
+
+      if (!inside)
+        continue;
+
+      float invW = (weights[0] * v0.z + weights[1] * v1.z + weights[2] * v2.z) / area;
+      float depth = (1.f + OCCLUSION_DEPTH_BIAS) / invW;
+
+      float& stored = depthBuffer[y * OCCLUSION_BUFFER_WIDTH + x];
+      stored = std::min(stored, depth);
+    }
+  }
+}
+
+void OcclusionCuller::buildPyramid() {
+  for (size_t l = 1; l < _pyramid.size(); l++) {
+    const std::vector<float>& below = _pyramid[l-1];
+    glm::uvec2 belowSize = _levelSizes[l-1];
+    glm::uvec2 size = _levelSizes[l];
+
+    for (unsigned int y = 0; y < size.y; y++) {
+      for (unsigned int x = 0; x < size.x; x++) {
+        // Odd sizes: the last texel covers the remaining row or column alone
+        unsigned int x0 = std::min(2*x, belowSize.x - 1), x1 = std::min(2*x + 1, belowSize.x - 1);
+        unsigned int y0 = std::min(2*y, belowSize.y - 1), y1 = std::min(2*y + 1, belowSize.y - 1);
+
+        _pyramid[l][y * size.x + x] = std::max(
+          std::max(below[y0 * belowSize.x + x0], below[y0 * belowSize.x + x1]),
+          std::max(below[y1 * belowSize.x + x0], below[y1 * belowSize.x + x1]));
+      }
+    }
+  }
+}
+
+bool OcclusionCuller::isBoxOccluded(glm::vec3 boxMin, glm::vec3 boxMax, const glm::mat4& viewProjection) const {
+  if (boxMin.x > boxMax.x)
+    return false;
+
+  glm::vec2 screenMin(std::numeric_limits<float>::max());
+  glm::vec2 screenMax(- std::numeric_limits<float>::max());
+  float minW = std::numeric_limits<float>::max();
+
+  for (int i = 0; i < 8; i++) {
+    glm::vec4 corner(i & 1 ? boxMax.x : boxMin.x,
+                     i & 2 ? boxMax.y : boxMin.y,
+                     i & 4 ? boxMax.z : boxMin.z, 1.f);
+    glm::vec4 clip = viewProjection * corner;
+
+    // The box reaches the camera
+    if (clip.w < OCCLUSION_NEAR_W)
+      return false;
+
+    glm::vec2 screen((clip.x / clip.w * 0.5f + 0.5f) * OCCLUSION_BUFFER_WIDTH,
+                     (clip.y / clip.w * 0.5f + 0.5f) * OCCLUSION_BUFFER_HEIGHT);
+
+    screenMin = glm::min(screenMin, screen);
+    screenMax = glm::max(screenMax, screen);
+    // w is linear, its minimum over the box is reached at a corner
+    minW = std::min(minW, clip.w);
+  }
+
+  // Outside of the screen, it is the job of the frustum culling
+  if (screenMax.x < 0 || screenMax.y < 0 ||
+      screenMin.x >= OCCLUSION_BUFFER_WIDTH || screenMin.y >= OCCLUSION_BUFFER_HEIGHT)
+    return false;
+
+  int xMin = std::max(0, (int) std::floor(screenMin.x));
+  int yMin = std::max(0, (int) std::floor(screenMin.y));
+  int xMax = std::min(OCCLUSION_BUFFER_WIDTH - 1,  (int) std::floor(screenMax.x));
+  int yMax = std::min(OCCLUSION_BUFFER_HEIGHT - 1, (int) std::floor(screenMax.y));
+
+  size_t level = 0;
+
+  while (level + 1 < _pyramid.size() &&
+         ((xMax >> level) - (xMin >> level) >= OCCLUSION_MAX_TEXELS ||
+          (yMax >> level) - (yMin >> level) >= OCCLUSION_MAX_TEXELS))
+    level++;
+
+  const std::vector<float>& depths = _pyramid[level];
+  unsigned int width = _levelSizes[level].x;
+  float maxDepth = 0.f;
+
+  for (int y = yMin >> level; y <= (yMax >> level); y++) {
+    for (int x = xMin >> level; x <= (xMax >> level); x++) {
+      maxDepth = std::max(maxDepth, depths[y * width + x]);
+    }
+  }
+
+  return minW > maxDepth;
+}
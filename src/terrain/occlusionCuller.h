@@ -0,0 +1,51 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <memory>
+#include <stddef.h> // size_t
+#include <vector>
+
+class Chunk;
+
+// Resolution of the software depth buffer
+#define OCCLUSION_BUFFER_WIDTH 256
+#define OCCLUSION_BUFFER_HEIGHT 128
+
+/** Occlusion culling of the chunks on the CPU.
+  * The coarsest LOD of the visible chunks is rasterized in a small depth buffer
+  * from which a hierarchical depth pyramid is built. The bounding boxes of the
+  * terrain and of the content of each chunk are then tested against it.
+  */
+class OcclusionCuller {
+public:
+  OcclusionCuller();
+
+  // Sets the occlusion flags of the visible chunks
+  void computeOcclusion(const std::vector<std::unique_ptr<Chunk> >& terrain, const glm::mat4& viewProjection);
+
+  inline void switchEnabled() {_enabled = !_enabled;}
+  inline bool isEnabled() const {return _enabled;}
+
+  inline size_t getNbChunksCulled() const {return _nbChunksCulled;}
+  inline size_t getNbContentsCulled() const {return _nbContentsCulled;}
+
+private:
+  void clear();
+  void rasterizeChunk(const Chunk& chunk, const glm::mat4& viewProjection);
+  // The vertices contain the coordinates in pixels in x,y and 1/w in z
+  void rasterizeTriangle(glm::vec3 v0, glm::vec3 v1, glm::vec3 v2);
+  void buildPyramid();
+  bool isBoxOccluded(glm::vec3 boxMin, glm::vec3 boxMax, const glm::mat4& viewProjection) const;
+
+  bool _enabled;
+
+  // Each level stores the farthest depth (w in clip space) of the 2x2 texels below
+  std::vector<std::vector<float> > _pyramid;
+  std::vector<glm::uvec2> _levelSizes;
+
+  std::vector<glm::vec4> _clipVertices; // To avoid reallocations
+
+  size_t _nbChunksCulled;
+  size_t _nbContentsCulled;
+};
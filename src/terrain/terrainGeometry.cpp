@@ -437,7 +437,7 @@ std::list<const Triangle*> TerrainGeometry::SubdivisionLevel::getTrianglesInChun
   return res;
 }
 
-std::list<const Triangle*> TerrainGeometry::SubdivisionLevel::getTrianglesNearPos(glm::vec2 pos) const {
+const std::list<const Triangle*>& TerrainGeometry::SubdivisionLevel::getTrianglesNearPos(glm::vec2 pos) const {
   std::array<glm::uvec2, 2> intCoord = getSubChunkInfo(pos);
   return _trianglesInSubChunk[intCoord[0].x*NB_CHUNKS  + intCoord[0].y]
                              [intCoord[1].x*GRID_SUBDIV + intCoord[1].y];
@@ -465,12 +465,12 @@ bool TerrainGeometry::SubdivisionLevel::isWater(glm::vec2 pos) const {
          t->biome == Biome::RIVER;
 }
 
-float TerrainGeometry::SubdivisionLevel::getHeight(glm::vec2 pos) const {
+float TerrainGeometry::SubdivisionLevel::getHeight(glm::vec2 pos, float defaultHeight) const {
   float barCoord[3];
   const Triangle* t = Triangle::getTriangleContaining(pos, getTrianglesNearPos(pos), barCoord);
 
   if (t == nullptr)
-    return 0;
+    return defaultHeight;
 
   return barCoord[0]*t->vertices[0]->pos.z +
          barCoord[1]*t->vertices[1]->pos.z +
@@ -95,12 +95,13 @@ public:
     static std::list<Vertex*> getVertices(const std::list<const Triangle*> triangles);
 
     std::list<const Triangle*> getTrianglesInChunk(size_t x, size_t y) const;
-    std::list<const Triangle*> getTrianglesNearPos  (glm::vec2 pos) const;
+    const std::list<const Triangle*>& getTrianglesNearPos(glm::vec2 pos) const;
 
     std::list<const Triangle*> getTriangles() const;
 
     bool isWater(glm::vec2 pos) const;
-    float getHeight(glm::vec2 pos) const;
+    // defaultHeight is returned if no triangle contains pos
+    float getHeight(glm::vec2 pos, float defaultHeight = 0.f) const;
     Biome getBiome (glm::vec2 pos) const;
     glm::vec3 getNorm(glm::vec2 pos) const;
 
@@ -139,8 +140,8 @@ public:
   inline bool isWater(glm::vec2 pos, size_t subdivLvl) const  {
     return _subdivisionLevels[protectedSubdivLvl(pos, subdivLvl)]->isWater(pos);}
 
-  inline float getHeight(glm::vec2 pos, size_t subdivLvl) const {
-    return _subdivisionLevels[protectedSubdivLvl(pos, subdivLvl)]->getHeight(pos);}
+  inline float getHeight(glm::vec2 pos, size_t subdivLvl, float defaultHeight = 0.f) const {
+    return _subdivisionLevels[protectedSubdivLvl(pos, subdivLvl)]->getHeight(pos, defaultHeight);}
 
   inline Biome getBiome(glm::vec2 pos, size_t subdivLvl) const {
     return _subdivisionLevels[protectedSubdivLvl(pos, subdivLvl)]->getBiome(pos);}
@@ -4,14 +4,21 @@
 
 #include <SDL_image.h>
 #include <SDL2pp/SDL2pp.hh>
+#include <chrono>
 #include <cstdio>
 #include <fstream>
+#include <random>
 #include <sstream>
 
+#include "boidsKernel.h"
 #include "generatedImage.h"
 #include "reliefGenerator.h"
+#include "slotMap.h"
+#include "timerWheel.h"
 
 #define DELETE_LIST_NAME "to_delete"
+// The neighbours of the boids benchmark are the same from a run to the next
+#define BOIDS_BENCHMARK_SEED 42
 
 TestHandler::TestHandler (const Clock& beginningOfProg) :
   _beginningOfProg(beginningOfProg) {}
@@ -280,6 +287,92 @@ void TestHandler::testAngleFunctions() const {
     std::cout << "OK     - Clamp angles" << '\n';
 }
 
+void TestHandler::testSlotMap() const {
+  SlotMap<int> map;
+  SlotHandle first = map.insert(1);
+  SlotHandle second = map.insert(2);
+  SlotHandle third = map.insert(3);
+
+  // The last value is moved into the hole of the first one
+  map.erase(first);
+  bool erasedIsStale = map.get(first) == nullptr && !map.erase(first);
+  bool movedIsReachable = map.get(third) && *map.get(third) == 3 && map.get(second) && *map.get(second) == 2;
+
+  // The new value takes the slot of the first one, with another generation
+  SlotHandle reused = map.insert(4);
+  bool reusedIsStale = reused.index == first.index && map.get(first) == nullptr &&
+                       map.get(reused) && *map.get(reused) == 4;
+  movedIsReachable = movedIsReachable && map.get(third) && *map.get(third) == 3;
+
+  if (erasedIsStale && movedIsReachable && reusedIsStale && map.size() == 3)
+    std::cout << "OK     - Slot map handles after erase and slot reuse" << '\n';
+
+  else {
+    std::cout << "FAILED - Slot map handles after erase and slot reuse" << '\n';
+    std::cout << "         Erased handle stale: " << erasedIsStale << ", moved value reachable: " << movedIsReachable
+              << ", handle stale after reuse: " << reusedIsStale << '\n';
+  }
+}
+
+void TestHandler::testTimerWheel() const {
+  const int msTick = 10;
+  TimerWheel wheel(msTick);
+
+  // In ticks: the current slot, the last near slot, the wrap, the first timer cascaded, two beyond
+  // the far level, parked in its last slot, and one between two ticks
+  const size_t nbTimers = 7;
+  const int msTimes[nbTimers] = {0, 255*msTick, 256*msTick, 257*msTick, (64*256 + 10)*msTick,
+                                 (65*256 + 10)*msTick, 300*msTick + 3};
+  std::vector<int> nbExpirations(nbTimers, 0);
+  bool early = false;
+  bool late = false;
+
+  for (uint32_t id = 0; id < nbTimers; id++) {
+    wheel.schedule(id, msTimes[id]);
+  }
+
+  // Uneven steps, some shorter than a tick, up to past the farthest timer
+  const int msSteps[] = {7, 2540, 3, 10, 1, 19, 420, 17, 12345, 99999, 60000};
+  int msNow = 0;
+  std::vector<uint32_t> expired;
+
+  for (int msStep : msSteps) {
+    msNow += msStep;
+    expired.clear();
+    wheel.advance(msNow, expired);
+
+    for (size_t k = 0; k < expired.size(); k++) {
+      nbExpirations[expired[k]]++;
+
+      if (msTimes[expired[k]] > msNow)
+        early = true;
+    }
+
+    // Rounded up to a tick, a timer scheduled for the current tick fires with the next one
+    for (uint32_t id = 0; id < nbTimers; id++) {
+      int tick = std::max(1, (msTimes[id] + msTick - 1) / msTick);
+
+      if (tick <= msNow / msTick && nbExpirations[id] == 0)
+        late = true;
+    }
+  }
+
+  bool onceEach = true;
+  for (uint32_t id = 0; id < nbTimers; id++) {
+    if (nbExpirations[id] != 1)
+      onceEach = false;
+  }
+
+  if (onceEach && !early && !late && wheel.size() == 0)
+    std::cout << "OK     - Timer wheel expirations across the near and far levels" << '\n';
+
+  else {
+    std::cout << "FAILED - Timer wheel expirations across the near and far levels" << '\n';
+    std::cout << "         Each timer fired once: " << onceEach << ", one fired early: " << early
+              << ", one fired late: " << late << ", timers left: " << wheel.size() << '\n';
+  }
+}
+
 void TestHandler::runTests(const Controller& controller) const {
   std::cout << "Initialization time: " << _beginningOfProg.getElapsedTime() << '\n';
   displayEngineGeneratedComponents(controller._engine);
@@ -287,6 +380,95 @@ void TestHandler::runTests(const Controller& controller) const {
   testPerlin();
   testGeneratedImage();
   testAngleFunctions();
+  testSlotMap();
+  testTimerWheel();
+  benchmarkBoidsKernel();
+}
+
+namespace {
+  // The loop computing the boids info before the kernel, one neighbour at a time
+  BoidsInfo boidsInfoReference(glm::vec2 pos, const std::vector<glm::vec2>& positions,
+    const std::vector<glm::vec2>& directions, float repulsion, float orientation, float attraction) {
+
+    BoidsInfo res;
+    res.minRepDst = repulsion;
+
+    for (size_t i = 0; i < positions.size(); i++) {
+      float distance = glm::length(pos - positions[i]);
+
+      if (distance < repulsion) {
+        if (distance < res.minRepDst) {
+          res.closestRep = positions[i];
+          res.minRepDst = distance;
+        }
+      }
+
+      else if (distance < orientation) {
+        res.sumOfDirs += directions[i];
+        res.nbDir++;
+      }
+
+      else if (distance < attraction) {
+        res.sumPosAttract += positions[i];
+        res.nbAttract++;
+      }
+    }
+
+    return res;
+  }
+}
+
+void TestHandler::benchmarkBoidsKernel() const {
+  const size_t nbNeighboursTested[3] = {10, 100, 1000};
+  const int repetitions = 10000;
+  const float repulsion = 8.f;
+  // The game goes on after the tests, the global rand is left alone
+  std::mt19937 rng(BOIDS_BENCHMARK_SEED);
+  std::uniform_real_distribution<float> random(0.f, 1.f);
+
+  for (size_t n : nbNeighboursTested) {
+    glm::vec2 pos(1000.f, 1000.f);
+    std::vector<glm::vec2> positions, directions;
+    BoidsNeighbours neighbours;
+
+    for (size_t i = 0; i < n; i++) {
+      float r = random(rng) * 60.f;
+      float theta = random(rng) * 2.f * M_PI;
+      positions.push_back(pos + r * glm::vec2(cos(theta), sin(theta)));
+      directions.push_back(glm::vec2(cos(theta), -sin(theta)));
+      neighbours.push(positions.back(), directions.back());
+    }
+
+    BoidsInfo reference, kernel;
+    float checksum = 0.f; // Prevents the loops from being optimized out
+
+    auto start = std::chrono::steady_clock::now();
+    for (int k = 0; k < repetitions; k++) {
+      reference = boidsInfoReference(pos, positions, directions, repulsion, 15.f, 50.f);
+      checksum += reference.sumPosAttract.x;
+    }
+    auto middle = std::chrono::steady_clock::now();
+    for (int k = 0; k < repetitions; k++) {
+      computeBoidsInfo(pos, neighbours, repulsion, 15.f, 50.f, kernel);
+      checksum += kernel.sumPosAttract.x;
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    double usReference = std::chrono::duration<double, std::micro>(middle - start).count() / repetitions;
+    double usKernel    = std::chrono::duration<double, std::micro>(end - middle).count() / repetitions;
+
+    // The sums are accumulated in another order, only the decisions must be identical. Without
+    // a neighbour in the repulsion zone, there is no closest one to compare
+    bool sameRepulsion = kernel.minRepDst == reference.minRepDst &&
+                         (reference.minRepDst >= repulsion || kernel.closestRep == reference.closestRep);
+
+    if (kernel.nbDir == reference.nbDir && kernel.nbAttract == reference.nbAttract && sameRepulsion)
+      std::cout << "OK     - Boids kernel with " << n << " neighbours: " << usKernel << " us, scalar loop: "
+                << usReference << " us (" << checksum << ")" << '\n';
+
+    else
+      std::cout << "FAILED - Boids kernel with " << n << " neighbours differs from the scalar loop" << '\n';
+  }
 }
 
 void TestHandler::clean() const {
@@ -28,6 +28,12 @@ private:
   void testPerlin() const;
   void testGeneratedImage() const;
   void testAngleFunctions() const;
+  // Stale handles after erase and slot reuse, and the value moved by the erase
+  void testSlotMap() const;
+  // Schedules timers around the wrap of the near level and beyond the far one
+  void testTimerWheel() const;
+  // Compares the boids kernel with the scalar loop it replaced, for several numbers of neighbours
+  void benchmarkBoidsKernel() const;
 
   const Clock& _beginningOfProg;
 };
@@ -0,0 +1,37 @@
+#include "allocationCounter.h"
+
+#include <cstdlib>
+#include <new>
+
+namespace {
+  thread_local size_t nbAllocations = 0;
+}
+
+size_t ut::getNbAllocations() {
+  return nbAllocations;
+}
+
+#ifndef NDEBUG
+void* operator new(size_t size) {
+  nbAllocations++;
+
+  void* p = malloc(size != 0 ? size : 1);
+
+  if (!p)
+    throw std::bad_alloc();
+
+  return p;
+}
+
+void* operator new[](size_t size) {
+  return operator new(size);
+}
+
+void operator delete(void* p) noexcept {
+  free(p);
+}
+
+void operator delete[](void* p) noexcept {
+  free(p);
+}
+#endif
@@ -0,0 +1,9 @@
+#pragma once
+
+#include <stddef.h> // size_t
+
+namespace ut {
+  // Calls to operator new made by the calling thread since it started. They are only
+  // counted in debug builds, where the global operator new is replaced, otherwise it is 0
+  size_t getNbAllocations();
+}
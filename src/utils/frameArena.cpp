@@ -0,0 +1,58 @@
+#include "frameArena.h"
+
+#include <algorithm>
+#include <new>
+#include <stdint.h>
+
+FrameArena::FrameArena(size_t initialSize) :
+  _blockSize(initialSize),
+  _used(0),
+  _usage(0) {
+  _block = static_cast<char*>(::operator new(_blockSize));
+}
+
+FrameArena::~FrameArena() {
+  reset();
+  ::operator delete(_block);
+}
+
+void* FrameArena::allocate(size_t size, size_t alignment) {
+  uintptr_t top = reinterpret_cast<uintptr_t>(_block) + _used;
+  size_t padding = (alignment - top % alignment) % alignment;
+  _usage += size + padding;
+
+  if (_used + padding + size <= _blockSize) {
+    void* p = _block + _used + padding;
+    _used += padding + size;
+    return p;
+  }
+
+  // Aligned for any standard type, and seen by the allocation counter
+  void* p = ::operator new(size);
+  _overflow.push_back(p);
+  return p;
+}
+
+void FrameArena::deallocate(void* p, size_t size) {
+  // Only the last allocation can be taken back without leaving a hole
+  if (static_cast<char*>(p) + size == _block + _used)
+    _used = static_cast<char*>(p) - _block;
+}
+
+void FrameArena::reset() {
+  if (!_overflow.empty()) {
+    for (size_t i = 0; i < _overflow.size(); i++) {
+      ::operator delete(_overflow[i]);
+    }
+
+    _overflow.clear();
+
+    // With some room for the frames asking a bit more
+    _blockSize = std::max(_blockSize * 2, _usage + _usage / 2);
+    ::operator delete(_block);
+    _block = static_cast<char*>(::operator new(_blockSize));
+  }
+
+  _used = 0;
+  _usage = 0;
+}
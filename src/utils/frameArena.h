@@ -0,0 +1,68 @@
+#pragma once
+
+#include <stddef.h> // size_t
+#include <vector>
+
+#define FRAME_ARENA_INITIAL_SIZE (64 * 1024)
+
+/** Linear allocator for the data that does not outlive a frame. An allocation moves
+  * a pointer forward in a block, and reset frees all of them at once.
+  * When a frame needs more than the block, the extra allocations are taken from the
+  * heap, and the next reset replaces the block with one large enough for that frame,
+  * so that a frame like the previous ones does not call malloc.
+  * Deallocations are ignored, except the one of the last allocation, which gives back
+  * the memory of a container freed before anything else is allocated. A growing vector
+  * allocates its new buffer before freeing the old one, which stays lost until the reset:
+  * reserve the vectors whose size is bounded.
+  */
+class FrameArena {
+public:
+  FrameArena(size_t initialSize = FRAME_ARENA_INITIAL_SIZE);
+  ~FrameArena();
+
+  FrameArena(const FrameArena&)      = delete;
+  void operator=(const FrameArena&)  = delete;
+
+  void* allocate(size_t size, size_t alignment);
+  void deallocate(void* p, size_t size);
+  // Invalidates every allocation of the arena
+  void reset();
+
+  inline size_t getCapacity() const {return _blockSize;}
+  // Bytes asked since the last reset, including the overflow
+  inline size_t getUsage() const {return _usage;}
+
+private:
+  char* _block;
+  size_t _blockSize;
+  size_t _used; // In _block
+  size_t _usage;
+  std::vector<void*> _overflow; // Freed by reset
+};
+
+// Allocator of the standard containers drawing from a FrameArena, which must outlive them
+template <typename T>
+class FrameAllocator {
+public:
+  typedef T value_type;
+
+  FrameAllocator(FrameArena& arena) : _arena(&arena) {}
+  template <typename U>
+  FrameAllocator(const FrameAllocator<U>& other) : _arena(other.getArena()) {}
+
+  inline T* allocate(size_t n) {return static_cast<T*>(_arena->allocate(n * sizeof(T), alignof(T)));}
+  inline void deallocate(T* p, size_t n) {_arena->deallocate(p, n * sizeof(T));}
+
+  inline FrameArena* getArena() const {return _arena;}
+
+private:
+  FrameArena* _arena;
+};
+
+template <typename T, typename U>
+inline bool operator==(const FrameAllocator<T>& a, const FrameAllocator<U>& b) {return a.getArena() == b.getArena();}
+template <typename T, typename U>
+inline bool operator!=(const FrameAllocator<T>& a, const FrameAllocator<U>& b) {return a.getArena() != b.getArena();}
+
+template <typename T>
+using FrameVector = std::vector<T, FrameAllocator<T> >;
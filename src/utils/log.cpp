@@ -4,18 +4,18 @@
 
 #define LOG_REFRESH_RATE_MS 1000
 
-Log::Log() {
-  _text.precision(2);
-  _text.setf( std::ios::fixed, std:: ios::floatfield );
+Log::Log() :
+  _framesSinceLastUpdate(0),
+  _lastFPS(0),
+  _textBuffer(_text),
+  _stream(&_textBuffer) {
+  _stream.precision(2);
+  _stream.setf( std::ios::fixed, std:: ios::floatfield );
 }
 
 void Log::addFPSandCamInfo() {
   if (_lastFPSupdate.getElapsedTime() > LOG_REFRESH_RATE_MS) {
-    _lastFPS.str("");
-
-    size_t fps = 1000 * _framesSinceLastUpdate / _lastFPSupdate.getElapsedTime();
-
-    _lastFPS << "FPS: " << fps << std::endl;
+    _lastFPS = 1000 * _framesSinceLastUpdate / _lastFPSupdate.getElapsedTime();
     _framesSinceLastUpdate = 1;
     _lastFPSupdate.restart();
   }
@@ -24,15 +24,16 @@ void Log::addFPSandCamInfo() {
     _framesSinceLastUpdate++;
 
   Camera& cam = Camera::getInstance();
-  _text << "R: " << (int) cam.getZoom() << "\n";
+  _stream << "R: " << (int) cam.getZoom() << "\n";
 
   #ifndef __ANDROID__
-    _text << "Theta: " << cam.getTheta() - 360 * (int) (cam.getTheta() / 360) +
-                         (cam.getTheta() < 0 ? 360 : 0) << "\n"
-          << "Phi: " << cam.getPhi() << std::endl;
-    _text << "X: " << cam.getPointedPos().x << "\n"
-          << "Y: " << cam.getPointedPos().y << std::endl;
+    _stream << "Theta: " << cam.getTheta() - 360 * (int) (cam.getTheta() / 360) +
+                            (cam.getTheta() < 0 ? 360 : 0) << "\n"
+            << "Phi: " << cam.getPhi() << std::endl;
+    _stream << "X: " << cam.getPointedPos().x << "\n"
+            << "Y: " << cam.getPointedPos().y << std::endl;
   #endif
 
-  _text << _lastFPS.str();
+  if (_lastFPS > 0)
+    _stream << "FPS: " << _lastFPS << std::endl;
 }
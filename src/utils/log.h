@@ -1,12 +1,14 @@
 #pragma once
 
-#include <sstream>
+#include <ostream>
 #include <stddef.h> // size_t
+#include <streambuf>
+#include <string>
 
 #include "clock.h"
 
 /** Singleton class in which any function can store info to be displayed on the
-  * screen
+  * screen. The text keeps its memory from a frame to the next
 	*/
 class Log	{
 public:
@@ -18,19 +20,44 @@ public:
 	Log(Log const&)             = delete;
 	void operator=(Log const&)  = delete;
 
-	inline void clear() {_text.str("");}
-	inline void addLine(std::string newLine) { _text << newLine;}
+	inline void clear() {_text.clear();}
+	inline void addLine(const std::string& newLine) {_stream << newLine;}
+	// Formats the values directly into the text
+	inline std::ostream& getStream() {return _stream;}
 	void addFPSandCamInfo();
-	inline std::string getText() const {return _text.str();}
+	inline const std::string& getText() const {return _text;}
 
 
 private:
 	Log();
 
+	// Appends to the text, which an ostringstream could only give back as a copy
+	class TextBuffer : public std::streambuf {
+	public:
+		TextBuffer(std::string& text) : _text(text) {}
+
+	protected:
+		int_type overflow(int_type c) override {
+			if (c != traits_type::eof())
+				_text.push_back(traits_type::to_char_type(c));
+			return c;
+		}
+
+		std::streamsize xsputn(const char* s, std::streamsize n) override {
+			_text.append(s, n);
+			return n;
+		}
+
+	private:
+		std::string& _text;
+	};
+
 	Clock _lastFPSupdate;
 
 	size_t _framesSinceLastUpdate;
-	std::ostringstream _lastFPS;
+	size_t _lastFPS; // 0 until the first update
 
-	std::ostringstream _text;
+	std::string _text;
+	TextBuffer _textBuffer;
+	std::ostream _stream;
 };
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <atomic>
+#include <utility>
+
+/** Unbounded lock-free queue with several producers and a single consumer.
+  * Pushing is wait-free (one atomic exchange), popping never blocks: it returns
+  * false when the queue is empty or when the last push is not finished yet.
+  * T must be default constructible and movable.
+  */
+template <typename T>
+class MPSCQueue {
+public:
+  MPSCQueue() :
+    _head(new Node()),
+    _tail(_head.load()) {}
+
+  MPSCQueue(MPSCQueue const&)       = delete;
+  void operator=(MPSCQueue const&)  = delete;
+
+  ~MPSCQueue() {
+    T value;
+    while (pop(value)) {}
+    delete _tail;
+  }
+
+  // Can be called from any thread
+  void push(T value) {
+    Node* node = new Node();
+    node->value = std::move(value);
+
+    Node* previous = _head.exchange(node, std::memory_order_acq_rel);
+    previous->next.store(node, std::memory_order_release);
+  }
+
+  // Must always be called from the same thread
+  bool pop(T& value) {
+    Node* next = _tail->next.load(std::memory_order_acquire);
+
+    if (next == nullptr)
+      return false;
+
+    value = std::move(next->value);
+
+    // next becomes the new empty node at the front of the queue
+    delete _tail;
+    _tail = next;
+
+    return true;
+  }
+
+private:
+  struct Node {
+    Node() : next(nullptr) {}
+
+    std::atomic<Node*> next;
+    T value;
+  };
+
+  std::atomic<Node*> _head; // Last pushed node
+  Node* _tail;              // Already consumed node, its next one is the front of the queue
+};
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <stddef.h> // size_t
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+// Identifies a value of a SlotMap, the generation tells apart the values that reused the same slot
+struct SlotHandle {
+  uint32_t index;
+  uint32_t generation;
+
+  inline bool operator==(const SlotHandle& other) const {return index == other.index && generation == other.generation;}
+  inline bool operator!=(const SlotHandle& other) const {return !(*this == other);}
+  inline bool operator< (const SlotHandle& other) const {
+    return index < other.index || (index == other.index && generation < other.generation);
+  }
+};
+
+// Never returned by a SlotMap, the generations start at 1
+#define INVALID_SLOT_HANDLE SlotHandle{UINT32_MAX, 0}
+
+/** Stores values behind handles that stay valid until the value is erased, and
+  * are detected as such afterwards. Insertion, erasure and lookup are O(1).
+  * The values are packed in a vector, erasing moves the last one in the hole,
+  * so the order of iteration changes and the pointers to values do not last.
+  */
+template <typename T>
+class SlotMap {
+public:
+  SlotHandle insert(T value) {
+    uint32_t index;
+
+    if (_freeSlots.empty()) {
+      index = _slots.size();
+      _slots.push_back(Slot{1, 0});
+    }
+
+    else {
+      index = _freeSlots.back();
+      _freeSlots.pop_back();
+    }
+
+    _slots[index].valueIndex = _values.size();
+    _values.push_back(std::move(value));
+    _valueSlots.push_back(index);
+
+    return SlotHandle{index, _slots[index].generation};
+  }
+
+  // Returns false if the value had already been erased
+  bool erase(SlotHandle handle) {
+    if (!contains(handle))
+      return false;
+
+    uint32_t valueIndex = _slots[handle.index].valueIndex;
+
+    if (valueIndex != _values.size() - 1) {
+      _values[valueIndex] = std::move(_values.back());
+      _valueSlots[valueIndex] = _valueSlots.back();
+      _slots[_valueSlots[valueIndex]].valueIndex = valueIndex;
+    }
+
+    _values.pop_back();
+    _valueSlots.pop_back();
+
+    // The handles still pointing to this slot become invalid
+    _slots[handle.index].generation++;
+    _freeSlots.push_back(handle.index);
+    return true;
+  }
+
+  inline bool contains(SlotHandle handle) const {
+    return handle.index < _slots.size() && _slots[handle.index].generation == handle.generation;
+  }
+
+  // nullptr if the value has been erased
+  inline       T* get(SlotHandle handle)       {return contains(handle) ? &_values[_slots[handle.index].valueIndex] : nullptr;}
+  inline const T* get(SlotHandle handle) const {return contains(handle) ? &_values[_slots[handle.index].valueIndex] : nullptr;}
+
+  // Handle of the i-th packed value
+  inline SlotHandle getHandle(size_t i) const {return SlotHandle{_valueSlots[i], _slots[_valueSlots[i]].generation};}
+
+  inline size_t size() const {return _values.size();}
+  inline typename std::vector<T>::iterator       begin()       {return _values.begin();}
+  inline typename std::vector<T>::iterator       end()         {return _values.end();}
+  inline typename std::vector<T>::const_iterator begin() const {return _values.begin();}
+  inline typename std::vector<T>::const_iterator end()   const {return _values.end();}
+
+private:
+  struct Slot {
+    uint32_t generation;
+    uint32_t valueIndex;
+  };
+
+  std::vector<T> _values;
+  std::vector<uint32_t> _valueSlots; // Slot of each value
+  std::vector<Slot> _slots;
+  std::vector<uint32_t> _freeSlots;
+};
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <stddef.h> // size_t
+#include <stdint.h>
+#include <vector>
+
+#define TIMER_WHEEL_NEAR_SLOTS 256
+#define TIMER_WHEEL_FAR_SLOTS 64
+
+/** Hierarchical timer wheel: ids are scheduled at a time in ms, and handed back by
+  * advance once the time of the frame reaches it. Scheduling is O(1) and a frame only
+  * touches the slots of the ticks it goes through, whatever the number of timers.
+  * The near level has a slot per tick, the far level a slot per turn of the near one,
+  * emptied into it when the turn begins. The timers beyond the far level wait in
+  * its last slot and are put back at their place when it is emptied.
+  * A timer cannot be cancelled, the owner ignores the ones that are out of date.
+  */
+class TimerWheel {
+public:
+  TimerWheel(int msTick) :
+    _msTick(msTick),
+    _currentTick(0),
+    _size(0) {}
+
+  void schedule(uint32_t id, int msTime) {
+    // Rounded up, so that a timer never fires before its time
+    int64_t tick = ((int64_t) msTime + _msTick - 1) / _msTick;
+    insert(Timer{id, tick});
+    _size++;
+  }
+
+  // Goes through the ticks up to msNow, and appends the ids of the timers reached to expired
+  void advance(int msNow, std::vector<uint32_t>& expired) {
+    int64_t nowTick = msNow / _msTick;
+
+    while (_currentTick < nowTick) {
+      int64_t tick = _currentTick + 1;
+
+      if (tick % TIMER_WHEEL_NEAR_SLOTS == 0) {
+        std::vector<Timer> cascaded;
+        cascaded.swap(_far[(tick / TIMER_WHEEL_NEAR_SLOTS) % TIMER_WHEEL_FAR_SLOTS]);
+
+        for (size_t i = 0; i < cascaded.size(); i++) {
+          insert(cascaded[i]);
+        }
+
+        // No timer goes back to the slot being emptied, it gets its memory back
+        cascaded.clear();
+        cascaded.swap(_far[(tick / TIMER_WHEEL_NEAR_SLOTS) % TIMER_WHEEL_FAR_SLOTS]);
+      }
+
+      std::vector<Timer>& slot = _near[tick % TIMER_WHEEL_NEAR_SLOTS];
+
+      for (size_t i = 0; i < slot.size(); i++) {
+        expired.push_back(slot[i].id);
+      }
+
+      _size -= slot.size();
+      slot.clear();
+      _currentTick = tick;
+    }
+  }
+
+  inline size_t size() const {return _size;}
+
+private:
+  struct Timer {
+    uint32_t id;
+    int64_t tick;
+  };
+
+  void insert(Timer timer) {
+    // Late timers fire with the next tick
+    if (timer.tick <= _currentTick)
+      timer.tick = _currentTick + 1;
+
+    if (timer.tick - _currentTick <= TIMER_WHEEL_NEAR_SLOTS)
+      _near[timer.tick % TIMER_WHEEL_NEAR_SLOTS].push_back(timer);
+
+    else {
+      int64_t turn = timer.tick / TIMER_WHEEL_NEAR_SLOTS;
+      int64_t lastTurn = _currentTick / TIMER_WHEEL_NEAR_SLOTS + TIMER_WHEEL_FAR_SLOTS - 1;
+      _far[std::min(turn, lastTurn) % TIMER_WHEEL_FAR_SLOTS].push_back(timer);
+    }
+  }
+
+  const int _msTick;
+  int64_t _currentTick; // Last tick gone through
+  size_t _size;
+
+  std::array<std::vector<Timer>, TIMER_WHEEL_NEAR_SLOTS> _near;
+  std::array<std::vector<Timer>, TIMER_WHEEL_FAR_SLOTS> _far;
+};